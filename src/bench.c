@@ -0,0 +1,455 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// emulator_bench: runs guest workloads and prints one CSV line per workload
+// with host time per instruction, emulated MIPS and the effective clock.
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cpu.h"
+#include "loader.h"
+#include "lockstep.h"
+
+// Every workload is loaded at $0200, ends in BRK, and has a check for what it
+// left in memory. Input data lives at $4000-$7FFF.
+#define CODE_START 0x0200
+#define DATA_START 0x4000
+#define DATA_SIZE 0x4000
+
+// Counts the primes below 8192 into $00/$01, sieving in $1000-$2FFF.
+static const BYTE sieve_code[] = {
+    0xA9, 0x01,              // 0200  LDA #$01
+    0xA0, 0x00,              // 0202  LDY #$00
+    0x84, 0x08,              // 0204  STY $08
+    0xA2, 0x10,              // 0206  LDX #$10
+    0x86, 0x09,              // 0208  STX $09
+    0xA2, 0x20,              // 020A  LDX #$20
+    0x91, 0x08,              // 020C  fill: STA ($08),Y
+    0xC8,                    // 020E  INY
+    0xD0, 0xFB,              // 020F  BNE fill
+    0xE6, 0x09,              // 0211  INC $09
+    0xCA,                    // 0213  DEX
+    0xD0, 0xF6,              // 0214  BNE fill
+    0x84, 0x00,              // 0216  STY $00
+    0x84, 0x01,              // 0218  STY $01
+    0xA9, 0x02,              // 021A  LDA #$02
+    0x85, 0x04,              // 021C  STA $04
+    0x84, 0x05,              // 021E  STY $05
+    0xA5, 0x04,              // 0220  outer: LDA $04
+    0x85, 0x08,              // 0222  STA $08
+    0xA5, 0x05,              // 0224  LDA $05
+    0x18,                    // 0226  CLC
+    0x69, 0x10,              // 0227  ADC #$10
+    0x85, 0x09,              // 0229  STA $09
+    0xB1, 0x08,              // 022B  LDA ($08),Y
+    0xF0, 0x33,              // 022D  BEQ next
+    0xE6, 0x00,              // 022F  INC $00
+    0xD0, 0x02,              // 0231  BNE mult
+    0xE6, 0x01,              // 0233  INC $01
+    0xA5, 0x04,              // 0235  mult: LDA $04
+    0x0A,                    // 0237  ASL A
+    0x85, 0x06,              // 0238  STA $06
+    0xA5, 0x05,              // 023A  LDA $05
+    0x2A,                    // 023C  ROL A
+    0x85, 0x07,              // 023D  STA $07
+    0xA5, 0x07,              // 023F  inner: LDA $07
+    0xC9, 0x20,              // 0241  CMP #$20
+    0xB0, 0x1D,              // 0243  BCS next
+    0xA5, 0x06,              // 0245  LDA $06
+    0x85, 0x08,              // 0247  STA $08
+    0xA5, 0x07,              // 0249  LDA $07
+    0x69, 0x10,              // 024B  ADC #$10
+    0x85, 0x09,              // 024D  STA $09
+    0x98,                    // 024F  TYA
+    0x91, 0x08,              // 0250  STA ($08),Y
+    0x18,                    // 0252  CLC
+    0xA5, 0x06,              // 0253  LDA $06
+    0x65, 0x04,              // 0255  ADC $04
+    0x85, 0x06,              // 0257  STA $06
+    0xA5, 0x07,              // 0259  LDA $07
+    0x65, 0x05,              // 025B  ADC $05
+    0x85, 0x07,              // 025D  STA $07
+    0x4C, 0x3F, 0x02,        // 025F  JMP inner
+    0xE6, 0x04,              // 0262  next: INC $04
+    0xD0, 0x02,              // 0264  BNE check
+    0xE6, 0x05,              // 0266  INC $05
+    0xA5, 0x05,              // 0268  check: LDA $05
+    0xC9, 0x20,              // 026A  CMP #$20
+    0xD0, 0xB2,              // 026C  BNE outer
+    0x00, 0x00,              // 026E  BRK
+};
+
+// CRC-32 (the zlib one) of $4000-$43FF into $10-$13, bit by bit.
+static const BYTE crc32_code[] = {
+    0xA9, 0xFF,              // 0200  LDA #$FF
+    0x85, 0x10,              // 0202  STA $10
+    0x85, 0x11,              // 0204  STA $11
+    0x85, 0x12,              // 0206  STA $12
+    0x85, 0x13,              // 0208  STA $13
+    0xA0, 0x00,              // 020A  LDY #$00
+    0x84, 0x08,              // 020C  STY $08
+    0xA9, 0x40,              // 020E  LDA #$40
+    0x85, 0x09,              // 0210  STA $09
+    0xA2, 0x04,              // 0212  LDX #$04
+    0xB1, 0x08,              // 0214  byte: LDA ($08),Y
+    0x45, 0x10,              // 0216  EOR $10
+    0x85, 0x10,              // 0218  STA $10
+    0xA9, 0x08,              // 021A  LDA #$08
+    0x85, 0x14,              // 021C  STA $14
+    0x46, 0x13,              // 021E  bit: LSR $13
+    0x66, 0x12,              // 0220  ROR $12
+    0x66, 0x11,              // 0222  ROR $11
+    0x66, 0x10,              // 0224  ROR $10
+    0x90, 0x18,              // 0226  BCC skip
+    0xA5, 0x13,              // 0228  LDA $13
+    0x49, 0xED,              // 022A  EOR #$ED
+    0x85, 0x13,              // 022C  STA $13
+    0xA5, 0x12,              // 022E  LDA $12
+    0x49, 0xB8,              // 0230  EOR #$B8
+    0x85, 0x12,              // 0232  STA $12
+    0xA5, 0x11,              // 0234  LDA $11
+    0x49, 0x83,              // 0236  EOR #$83
+    0x85, 0x11,              // 0238  STA $11
+    0xA5, 0x10,              // 023A  LDA $10
+    0x49, 0x20,              // 023C  EOR #$20
+    0x85, 0x10,              // 023E  STA $10
+    0xC6, 0x14,              // 0240  skip: DEC $14
+    0xD0, 0xDA,              // 0242  BNE bit
+    0xC8,                    // 0244  INY
+    0xD0, 0xCD,              // 0245  BNE byte
+    0xE6, 0x09,              // 0247  INC $09
+    0xCA,                    // 0249  DEX
+    0xD0, 0xC8,              // 024A  BNE byte
+    0xA2, 0x03,              // 024C  LDX #$03
+    0xB5, 0x10,              // 024E  final: LDA $10,X
+    0x49, 0xFF,              // 0250  EOR #$FF
+    0x95, 0x10,              // 0252  STA $10,X
+    0xCA,                    // 0254  DEX
+    0x10, 0xF7,              // 0255  BPL final
+    0x00, 0x00,              // 0257  BRK
+};
+
+// Copies $4000-$7FFF to $8000-$BFFF.
+static const BYTE memcpy_code[] = {
+    0xA0, 0x00,              // 0200  LDY #$00
+    0x84, 0x08,              // 0202  STY $08
+    0x84, 0x0A,              // 0204  STY $0A
+    0xA9, 0x40,              // 0206  LDA #$40
+    0x85, 0x09,              // 0208  STA $09
+    0xA9, 0x80,              // 020A  LDA #$80
+    0x85, 0x0B,              // 020C  STA $0B
+    0xA2, 0x40,              // 020E  LDX #$40
+    0xB1, 0x08,              // 0210  copy: LDA ($08),Y
+    0x91, 0x0A,              // 0212  STA ($0A),Y
+    0xC8,                    // 0214  INY
+    0xB1, 0x08,              // 0215  LDA ($08),Y
+    0x91, 0x0A,              // 0217  STA ($0A),Y
+    0xC8,                    // 0219  INY
+    0xD0, 0xF4,              // 021A  BNE copy
+    0xE6, 0x09,              // 021C  INC $09
+    0xE6, 0x0B,              // 021E  INC $0B
+    0xCA,                    // 0220  DEX
+    0xD0, 0xED,              // 0221  BNE copy
+    0x00, 0x00,              // 0223  BRK
+};
+
+static int check_sieve(Machine* m)
+{
+  static BYTE composite[8192];
+  int primes = 0;
+  for (int i = 2; i < 8192; i++)
+  {
+    if (!composite[i])
+    {
+      primes++;
+      for (int j = i + i; j < 8192; j += i)
+      {
+        composite[j] = 1;
+      }
+    }
+  }
+  return (m->memory[0x00] | m->memory[0x01] << 8) == primes;
+}
+
+static int check_crc32(Machine* m)
+{
+  unsigned long crc = 0xFFFFFFFF;
+  for (int i = 0; i < 0x400; i++)
+  {
+    crc ^= m->memory[DATA_START + i];
+    for (int bit = 0; bit < 8; bit++)
+    {
+      crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    }
+  }
+  crc ^= 0xFFFFFFFF;
+  unsigned long got = m->memory[0x10] | m->memory[0x11] << 8 | m->memory[0x12] << 16 |
+                      (unsigned long)m->memory[0x13] << 24;
+  return got == crc;
+}
+
+static int check_memcpy(Machine* m)
+{
+  return memcmp(m->memory + DATA_START, m->memory + 0x8000, DATA_SIZE) == 0;
+}
+
+typedef struct
+{
+  const char* name;
+  const BYTE* code;
+  size_t size;
+  int (*check)(Machine* m);
+} Workload;
+
+static const Workload workloads[] = {
+    {"sieve", sieve_code, sizeof sieve_code, check_sieve},
+    {"crc32", crc32_code, sizeof crc32_code, check_crc32},
+    {"memcpy", memcpy_code, sizeof memcpy_code, check_memcpy},
+};
+
+typedef struct
+{
+  unsigned long runs;
+  unsigned long long instructions;
+  unsigned long long cycles;
+  double seconds;
+  int ok;
+} Result;
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void print_result(const char* name, const Result* r)
+{
+  double insns = r->instructions;
+  printf("%s,%lu,%llu,%llu,%.6f,%.3f,%.2f,%.2f,%d\n", name, r->runs, r->instructions, r->cycles,
+         r->seconds, insns > 0 ? r->seconds * 1e9 / insns : 0.0, insns / r->seconds / 1e6,
+         r->cycles / r->seconds / 1e6, r->ok);
+}
+
+// Loads w with the next DATA_SIZE bytes from seed as input.
+static void setup(Machine* m, const Workload* w, unsigned long long* seed)
+{
+  mem_load(m, CODE_START, w->code, w->size);
+  for (int i = 0; i < DATA_SIZE; i++)
+  {
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    mem_write(m, DATA_START + i, (BYTE)*seed);
+  }
+  mem_write(m, 0xFFFC, CODE_START & 0xFF);
+  mem_write(m, 0xFFFD, CODE_START >> 8);
+  cpu_reset(m);
+}
+
+// Runs w from the same snapshot again and again for at least min_seconds. The
+// first run's result gets checked.
+static void run_workload(const Workload* w, double min_seconds, Result* r)
+{
+  memset(r, 0, sizeof *r);
+  Machine* m = machine_create();
+  if (m == NULL)
+  {
+    return;
+  }
+  unsigned long long seed = 88172645463325252ULL;
+  setup(m, w, &seed);
+  Snapshot* start = snapshot_create(m);
+  if (start == NULL)
+  {
+    machine_destroy(m);
+    return;
+  }
+  r->ok = 1;
+  double begin = now();
+  do
+  {
+    snapshot_restore(m, start);
+    StopReason reason = cpu_run(m, ULONG_MAX);
+    if (r->runs == 0)
+    {
+      r->ok = reason == STOP_BRK && w->check(m);
+    }
+    r->runs++;
+    r->instructions += m->instructions - start->instructions;
+    r->cycles += m->cycles - start->cycles;
+    r->seconds = now() - begin;
+  } while (r->ok && r->seconds < min_seconds);
+  snapshot_destroy(start);
+  machine_destroy(m);
+}
+
+// Same for lanes copies of w run by the lockstep engine, each on its own input.
+// Every lane's result gets checked on the first run.
+static void run_lockstep(const Workload* w, double min_seconds, int lanes, Result* r)
+{
+  memset(r, 0, sizeof *r);
+  Machine* m = machine_create();
+  Lockstep* g = lockstep_create();
+  Lockstep* start = lockstep_create();
+  if (m == NULL || g == NULL || start == NULL)
+  {
+    goto done;
+  }
+  unsigned long long seed = 88172645463325252ULL;
+  for (int lane = 0; lane < lanes; lane++)
+  {
+    setup(m, w, &seed);
+    lockstep_put(start, lane, m);
+  }
+  r->ok = 1;
+  double begin = now();
+  do
+  {
+    memcpy(g, start, sizeof *g);
+    lockstep_run(g, lanes, ULONG_MAX);
+    for (int lane = 0; lane < lanes; lane++)
+    {
+      if (r->runs == 0)
+      {
+        lockstep_get(g, lane, m);
+        r->ok &= g->reason[lane] == STOP_BRK && w->check(m);
+      }
+      r->instructions += g->instructions[lane] - start->instructions[lane];
+      r->cycles += g->cycles[lane] - start->cycles[lane];
+    }
+    r->runs++;
+    r->seconds = now() - begin;
+  } while (r->ok && r->seconds < min_seconds);
+done:
+  lockstep_destroy(start);
+  lockstep_destroy(g);
+  machine_destroy(m);
+}
+
+// Klaus Dormann's 6502_functional_test.bin, built for load address 0 and
+// started at $0400. It parks in a jump to itself when done, success is a
+// particular one of those.
+static void run_dormann(const char* path, WORD success, Result* r)
+{
+  memset(r, 0, sizeof *r);
+  Machine* m = machine_create();
+  Image image;
+  if (m == NULL || image_load(m, path, 0x0000, 0, &image) != 0)
+  {
+    machine_destroy(m);
+    return;
+  }
+  m->brk_interrupt = 1;
+  m->cpu.S = 0xFD;
+  m->cpu.PC = 0x0400;
+  double begin = now();
+  for (;;)
+  {
+    if (cpu_run(m, 1000000) != STOP_BUDGET)
+    {
+      break;
+    }
+    // Stuck if one more instruction does not move PC.
+    WORD pc = m->cpu.PC;
+    if (cpu_run(m, 1) != STOP_BUDGET || m->cpu.PC == pc)
+    {
+      break;
+    }
+  }
+  r->seconds = now() - begin;
+  r->runs = 1;
+  r->instructions = m->instructions;
+  r->cycles = m->cycles;
+  r->ok = m->cpu.PC == success;
+  if (!r->ok)
+  {
+    fprintf(stderr, "%s: stopped at PC=%04X\n", path, m->cpu.PC);
+  }
+  machine_destroy(m);
+}
+
+static void usage(const char* name)
+{
+  fprintf(stderr,
+          "usage: %s [-t min-seconds] [-l lanes] [-k 6502_functional_test.bin [-s success-pc]]\n",
+          name);
+}
+
+int main(int argc, char** argv)
+{
+  double min_seconds = 1.0;
+  const char* dormann_path = NULL;
+  unsigned long success = 0x3469;
+  int lanes = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "t:l:k:s:")) != -1)
+  {
+    switch (opt)
+    {
+    case 't':
+      min_seconds = atof(optarg);
+      break;
+    case 'l':
+      lanes = atoi(optarg);
+      if (lanes < 1 || lanes > LOCKSTEP_LANES)
+      {
+        fprintf(stderr, "lanes must be 1 to %d\n", LOCKSTEP_LANES);
+        return 2;
+      }
+      break;
+    case 'k':
+      dormann_path = optarg;
+      break;
+    case 's':
+      success = strtoul(optarg, NULL, 16);
+      break;
+    default:
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  int failed = 0;
+  Result r;
+  printf("workload,runs,instructions,cycles,seconds,ns_per_insn,mips,mhz,ok\n");
+  for (size_t i = 0; i < sizeof workloads / sizeof workloads[0]; i++)
+  {
+    run_workload(&workloads[i], min_seconds, &r);
+    print_result(workloads[i].name, &r);
+    failed |= !r.ok;
+    if (lanes != 0)
+    {
+      char name[64];
+      snprintf(name, sizeof name, "%s/x%d", workloads[i].name, lanes);
+      run_lockstep(&workloads[i], min_seconds, lanes, &r);
+      print_result(name, &r);
+      failed |= !r.ok;
+    }
+  }
+  if (dormann_path != NULL)
+  {
+    run_dormann(dormann_path, success, &r);
+    print_result("dormann", &r);
+    failed |= !r.ok;
+  }
+  return failed;
+}
@@ -0,0 +1,418 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "console.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// Bytes in each ring, a power of two.
+#define CONSOLE_RING_SIZE 4096
+
+// Single producer and single consumer, like the trace ring. head and tail
+// only ever grow and are masked on use, so head - tail is the fill level.
+// Moving either one is sequentially consistent, so that of the I/O thread
+// looking at the rings before it sleeps and the CPU changing them, at least
+// one sees the other.
+typedef struct
+{
+  BYTE data[CONSOLE_RING_SIZE];
+  _Alignas(64) atomic_ulong head;
+  _Alignas(64) atomic_ulong tail;
+} Ring;
+
+struct Console
+{
+  // The CPU fills send and empties receive, the I/O thread the other way round.
+  Ring send;
+  Ring receive;
+  Machine* machine;
+  unsigned irq;
+  BYTE control;
+  BYTE polling;
+  unsigned long dropped;
+  // Only the I/O thread uses these after console_open(), in becomes -1 at
+  // its end.
+  int in;
+  int out;
+  int failed;
+  // Under io.lock.
+  int closing;
+  int closed;
+};
+
+// The I/O thread of all consoles. It sleeps in poll() on wake, an eventfd, on
+// out of each console with bytes to send and on in of each with room to
+// receive. Whatever changes that set signals wake.
+static struct
+{
+  pthread_mutex_t lock;
+  pthread_cond_t closed;
+  Console* consoles[CONSOLE_MAX];
+  int count;
+  int stop;
+  int wake;
+  pthread_t thread;
+} io = {.lock = PTHREAD_MUTEX_INITIALIZER, .closed = PTHREAD_COND_INITIALIZER};
+
+// Returns -1 when full, otherwise whether the ring was empty.
+static int ring_push(Ring* r, BYTE value)
+{
+  unsigned long head = atomic_load_explicit(&r->head, memory_order_relaxed);
+  if (head - atomic_load_explicit(&r->tail, memory_order_acquire) == CONSOLE_RING_SIZE)
+  {
+    return -1;
+  }
+  r->data[head & (CONSOLE_RING_SIZE - 1)] = value;
+  atomic_store(&r->head, head + 1);
+  return atomic_load(&r->tail) == head;
+}
+
+// Returns -1 when empty, otherwise whether the ring was full.
+static int ring_pop(Ring* r, BYTE* value)
+{
+  unsigned long tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+  if (tail == atomic_load_explicit(&r->head, memory_order_acquire))
+  {
+    return -1;
+  }
+  *value = r->data[tail & (CONSOLE_RING_SIZE - 1)];
+  atomic_store(&r->tail, tail + 1);
+  return atomic_load(&r->head) - tail == CONSOLE_RING_SIZE;
+}
+
+static unsigned long ring_fill(Ring* r)
+{
+  return atomic_load(&r->head) - atomic_load(&r->tail);
+}
+
+static void wake_io(void)
+{
+  uint64_t one = 1;
+  // It only fails when the counter is already far from zero.
+  ssize_t written = write(io.wake, &one, sizeof one);
+  (void)written;
+}
+
+// Writes out some of what the guest sent, up to the end of the ring and at
+// most PIPE_BUF bytes, which a writable out takes without blocking. After a
+// failed write it only empties the ring.
+static void drain(Console* c)
+{
+  Ring* r = &c->send;
+  unsigned long tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+  unsigned long head = atomic_load_explicit(&r->head, memory_order_acquire);
+  unsigned long start = tail & (CONSOLE_RING_SIZE - 1);
+  unsigned long count = head - tail;
+  if (count > CONSOLE_RING_SIZE - start)
+  {
+    count = CONSOLE_RING_SIZE - start;
+  }
+  if (!c->failed)
+  {
+    ssize_t written = write(c->out, r->data + start, count < PIPE_BUF ? count : PIPE_BUF);
+    if (written < 0 && (errno == EINTR || errno == EAGAIN))
+    {
+      return;
+    }
+    if (written < 0)
+    {
+      // Keep emptying the ring so the guest can still send, the caller gets
+      // told on close.
+      c->failed = 1;
+    }
+    else
+    {
+      count = written;
+    }
+  }
+  atomic_store(&r->tail, tail + count);
+}
+
+// Reads what in has into the free part of the receive ring.
+static void fill(Console* c)
+{
+  Ring* r = &c->receive;
+  unsigned long head = atomic_load_explicit(&r->head, memory_order_relaxed);
+  unsigned long tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+  unsigned long start = head & (CONSOLE_RING_SIZE - 1);
+  unsigned long room = CONSOLE_RING_SIZE - (head - tail);
+  if (room > CONSOLE_RING_SIZE - start)
+  {
+    room = CONSOLE_RING_SIZE - start;
+  }
+  ssize_t count = read(c->in, r->data + start, room);
+  if (count < 0 && (errno == EINTR || errno == EAGAIN))
+  {
+    return;
+  }
+  if (count <= 0)
+  {
+    c->in = -1;
+    return;
+  }
+  atomic_store(&r->head, head + count);
+}
+
+static void* thread_main(void* arg)
+{
+  (void)arg;
+  pthread_mutex_lock(&io.lock);
+  while (!io.stop)
+  {
+    struct pollfd fds[1 + 2 * CONSOLE_MAX] = {{io.wake, POLLIN, 0}};
+    Console* owners[1 + 2 * CONSOLE_MAX];
+    int count = 1;
+    for (int i = 0; i < io.count; i++)
+    {
+      Console* c = io.consoles[i];
+      while (c->failed && ring_fill(&c->send) != 0)
+      {
+        drain(c);
+      }
+      int sending = ring_fill(&c->send) != 0;
+      if (c->closing && !sending)
+      {
+        io.consoles[i--] = io.consoles[--io.count];
+        c->closed = 1;
+        pthread_cond_broadcast(&io.closed);
+        continue;
+      }
+      if (sending)
+      {
+        fds[count] = (struct pollfd){c->out, POLLOUT, 0};
+        owners[count++] = c;
+      }
+      if (c->in >= 0 && ring_fill(&c->receive) != CONSOLE_RING_SIZE)
+      {
+        fds[count] = (struct pollfd){c->in, POLLIN, 0};
+        owners[count++] = c;
+      }
+    }
+    // Consoles only leave the table above, so owners stay valid without the
+    // lock.
+    pthread_mutex_unlock(&io.lock);
+    if (poll(fds, count, -1) > 0)
+    {
+      if (fds[0].revents != 0)
+      {
+        uint64_t wakes;
+        ssize_t got = read(io.wake, &wakes, sizeof wakes);
+        (void)got;
+      }
+      for (int i = 1; i < count; i++)
+      {
+        if (fds[i].revents != 0)
+        {
+          if (fds[i].events == POLLOUT)
+          {
+            drain(owners[i]);
+          }
+          else
+          {
+            fill(owners[i]);
+          }
+        }
+      }
+    }
+    pthread_mutex_lock(&io.lock);
+  }
+  pthread_mutex_unlock(&io.lock);
+  return NULL;
+}
+
+static BYTE status(Console* c)
+{
+  BYTE status = 0;
+  if (ring_fill(&c->receive) != 0)
+  {
+    status |= CONSOLE_RECEIVED;
+  }
+  if (ring_fill(&c->send) != CONSOLE_RING_SIZE)
+  {
+    status |= CONSOLE_ROOM;
+  }
+  if ((status & CONSOLE_RECEIVED) && (c->control & 0x01))
+  {
+    status |= CONSOLE_INTERRUPT;
+  }
+  return status;
+}
+
+static void poll_event(void* context);
+
+// Sets the IRQ line from the status, and keeps looking for input while
+// receive interrupts are on.
+static void settle(Console* c)
+{
+  cpu_set_irq(c->machine, c->irq, (status(c) & CONSOLE_INTERRUPT) != 0);
+  if ((c->control & 0x01) && !c->polling)
+  {
+    // With the event queue full the line still follows every access.
+    unsigned long long next = machine_now(c->machine) + CONSOLE_POLL_CYCLES;
+    c->polling = machine_schedule(c->machine, next, poll_event, c) == 0;
+  }
+}
+
+static void poll_event(void* context)
+{
+  Console* c = context;
+  c->polling = 0;
+  settle(c);
+}
+
+static BYTE console_read(void* context, WORD address)
+{
+  Console* c = context;
+  BYTE value;
+  switch (address & 0x03)
+  {
+  case 0:
+    value = 0;
+    if (ring_pop(&c->receive, &value) > 0)
+    {
+      // Room again, the thread can look at in.
+      wake_io();
+    }
+    break;
+  case 1:
+    value = status(c);
+    break;
+  case 2:
+    value = c->control;
+    break;
+  default:
+    value = 0xFF;
+    break;
+  }
+  settle(c);
+  return value;
+}
+
+static void console_write(void* context, WORD address, BYTE value)
+{
+  Console* c = context;
+  switch (address & 0x03)
+  {
+  case 0:
+  {
+    int pushed = ring_push(&c->send, value);
+    if (pushed < 0)
+    {
+      c->dropped++;
+    }
+    else if (pushed)
+    {
+      // Something to send, the thread can look at out.
+      wake_io();
+    }
+    break;
+  }
+  case 2:
+    c->control = value;
+    break;
+  default:
+    break;
+  }
+  settle(c);
+}
+
+Console* console_open(Machine* m, unsigned irq, int in, int out)
+{
+  Console* c = calloc(1, sizeof *c);
+  if (c == NULL)
+  {
+    return NULL;
+  }
+  c->machine = m;
+  c->irq = irq;
+  c->in = in;
+  c->out = out;
+  pthread_mutex_lock(&io.lock);
+  int err = 0;
+  if (io.count == CONSOLE_MAX)
+  {
+    err = EMFILE;
+  }
+  else if (io.count == 0)
+  {
+    // The first console starts the thread.
+    io.stop = 0;
+    io.wake = eventfd(0, EFD_CLOEXEC);
+    err = io.wake < 0 ? errno : pthread_create(&io.thread, NULL, thread_main, NULL);
+    if (err != 0 && io.wake >= 0)
+    {
+      close(io.wake);
+    }
+  }
+  if (err == 0)
+  {
+    io.consoles[io.count++] = c;
+    wake_io();
+  }
+  pthread_mutex_unlock(&io.lock);
+  if (err != 0)
+  {
+    free(c);
+    errno = err;
+    return NULL;
+  }
+  return c;
+}
+
+void console_map(Console* c, WORD start, WORD end)
+{
+  machine_map_io(c->machine, start, end, console_read, console_write, c);
+}
+
+unsigned long console_dropped(const Console* c)
+{
+  return c->dropped;
+}
+
+int console_close(Console* c)
+{
+  pthread_mutex_lock(&io.lock);
+  c->closing = 1;
+  wake_io();
+  while (!c->closed)
+  {
+    pthread_cond_wait(&io.closed, &io.lock);
+  }
+  // The last console stops the thread.
+  int last = io.count == 0;
+  io.stop = last;
+  pthread_mutex_unlock(&io.lock);
+  if (last)
+  {
+    wake_io();
+    pthread_join(io.thread, NULL);
+    close(io.wake);
+  }
+  machine_cancel(c->machine, poll_event, c);
+  cpu_set_irq(c->machine, c->irq, 0);
+  int failed = c->failed;
+  free(c);
+  return failed ? -1 : 0;
+}
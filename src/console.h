@@ -0,0 +1,68 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include "cpu.h"
+
+// Memory-mapped character console, a serial port without the baud rate.
+// Bytes the guest sends go into a ring that a host thread writes to a file
+// descriptor, and bytes the thread reads from another one come back through a
+// second ring. The CPU only ever touches the rings, so a slow or stuck
+// terminal never holds up the emulation. One thread serves all open consoles
+// and sleeps in poll() until a descriptor or a ring needs it.
+//
+// Registers, repeated every 4 bytes over the region:
+//
+//   0  data     read: takes the next byte received, write: sends a byte
+//   1  status   bit 0: a byte was received, bit 1: there is room to send,
+//               bit 7: the console is asking for an interrupt
+//   2  control  bit 0: interrupt while a received byte is waiting
+//
+// A byte sent while there is no room is dropped. With interrupts on, the
+// console looks for received bytes every CONSOLE_POLL_CYCLES.
+
+#define CONSOLE_POLL_CYCLES 10000
+// Consoles open at once.
+#define CONSOLE_MAX 16
+
+enum
+{
+  CONSOLE_RECEIVED = 0x01,
+  CONSOLE_ROOM = 0x02,
+  CONSOLE_INTERRUPT = 0x80,
+};
+
+typedef struct Console Console;
+
+// Creates a console on m that sends to out and receives from in (-1 for
+// nothing to receive). The first one starts the thread. Its interrupt drives
+// the irq bit(s) of the IRQ line. Returns NULL with errno set on failure,
+// EMFILE with CONSOLE_MAX open. Consoles are opened and closed from one
+// thread, the one running the machines.
+Console* console_open(Machine* m, unsigned irq, int in, int out);
+// Maps its registers over start..end.
+void console_map(Console* c, WORD start, WORD end);
+// Bytes the guest sent while the ring was full.
+unsigned long console_dropped(const Console* c);
+// Waits for everything sent so far to be written out and frees c. The last
+// one stops the thread. Pages mapped to c have to be mapped to something else first.
+// Returns 0, or -1 if anything could not be written.
+int console_close(Console* c);
+
+#endif
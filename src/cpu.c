@@ -0,0 +1,1464 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "cpu.h"
+
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef COVERAGE
+#include "fuzz.h"
+#endif
+#ifdef JOURNAL
+#include "journal.h"
+#endif
+#ifdef PROFILE
+#include "profile.h"
+#endif
+#include "replay.h"
+#ifdef TRACE
+#include "trace.h"
+#endif
+
+#define BREAKPOINT_AT(m, address) ADDRESS_BIT((m)->breakpoints, address)
+// For the slow paths of mem_read() and mem_write(). Inlined they make those too
+// big to inline into the opcode handlers, and cost the fast path register saves.
+#if defined(__GNUC__)
+#define NOINLINE __attribute__((noinline))
+#else
+#define NOINLINE
+#endif
+#ifdef LAZY_FLAGS
+#define GET_N(cpu) ((cpu)->n_result >> 7)
+#define GET_Z(cpu) ((cpu)->z_result == 0)
+#define GET_C(cpu) (((cpu)->c_result >> 8) & 1)
+#define GET_V(cpu) ((cpu)->v_result >> 7)
+#define SET_N(cpu, val) ((cpu)->n_result = (val))
+#define SET_Z(cpu, val) ((cpu)->z_result = (val))
+#define SET_CARRY(cpu, val) ((cpu)->c_result = (val))
+#define SET_OVERFLOW(cpu, val) ((cpu)->v_result = (val))
+#else
+#define GET_N(cpu) ((cpu)->P.N)
+#define GET_Z(cpu) ((cpu)->P.Z)
+#define GET_C(cpu) ((cpu)->P.C)
+#define GET_V(cpu) ((cpu)->P.V)
+#define SET_N(cpu, val) ((cpu)->P.N = ((val) & 0x80) != 0)
+#define SET_Z(cpu, val) ((cpu)->P.Z = ((BYTE)(val) == 0))
+#define SET_CARRY(cpu, val) ((cpu)->P.C = ((val) & 0x100) != 0)
+#define SET_OVERFLOW(cpu, val) ((cpu)->P.V = ((val) & 0x80) != 0)
+#endif
+
+// P with the lazy flags folded back in, for anything that needs the whole byte.
+Status cpu_status(const CPU* cpu)
+{
+  Status p = cpu->P;
+  p.N = GET_N(cpu);
+  p.Z = GET_Z(cpu);
+  p.C = GET_C(cpu);
+  p.V = GET_V(cpu);
+  return p;
+}
+
+BYTE cpu_status_byte(const CPU* cpu)
+{
+  Status p = cpu_status(cpu);
+  return p.N << 7 | p.V << 6 | p.U << 5 | p.B << 4 | p.D << 3 | p.I << 2 | p.Z << 1 | p.C;
+}
+
+// Unknown opcodes count as 1 byte and 2 cycles.
+#define LENGTH(name, code, mnemonic, mode, bytes, ...) [code] = bytes,
+#define CYCLES(name, code, mnemonic, mode, bytes, cycles, ...) [code] = cycles,
+#define PENALTY(name, code, mnemonic, mode, bytes, cycles, penalty, flags) [code] = penalty,
+#define UNKNOWN_LENGTH(code) [code] = 1,
+#define UNKNOWN_CYCLES(code) [code] = 2,
+#define UNKNOWN_PENALTY(code) [code] = 0,
+const BYTE instruction_length[256] = {OPCODE_TABLE(LENGTH, UNKNOWN_LENGTH)};
+
+// NMOS cycle counts without penalties.
+const BYTE base_cycles[256] = {OPCODE_TABLE(CYCLES, UNKNOWN_CYCLES)};
+
+// Most an instruction can add on top of base_cycles: one for an indexed read
+// crossing a page, two for a branch taken into another page.
+const BYTE max_penalty[256] = {OPCODE_TABLE(PENALTY, UNKNOWN_PENALTY)};
+#undef LENGTH
+#undef CYCLES
+#undef PENALTY
+#undef UNKNOWN_LENGTH
+#undef UNKNOWN_CYCLES
+#undef UNKNOWN_PENALTY
+
+#define PAGE_CROSSED(a, b) ((((a) ^ (b)) & 0xFF00) != 0)
+
+#define CODE_CACHEABLE(m, pc)                                                                      \
+  ((m)->page_type[(pc) >> 8] != PAGE_IO && (m)->page_type[(WORD)((pc) + 2) >> 8] != PAGE_IO)
+
+// Turns the direct pointers on for whatever the page currently allows.
+void update_fast_path(Machine* m, BYTE page)
+{
+  BYTE type = m->page_type[page];
+  BYTE watch = m->watch_page[page];
+  m->read_page[page] = type == PAGE_IO || watch & WATCH_READ ? NULL : m->host_page[page];
+  m->write_page[page] = type == PAGE_RAM && !m->code_page[page] && !m->clean_page[page] &&
+                                !(watch & WATCH_WRITE)
+                            ? m->host_page[page]
+                            : NULL;
+#ifdef JOURNAL
+  if (m->journal != NULL)
+  {
+    m->write_page[page] = NULL;
+  }
+#endif
+}
+
+// First write to a page since the baseline.
+void mark_dirty(Machine* m, BYTE page)
+{
+  if (m->clean_page[page])
+  {
+    m->clean_page[page] = 0;
+    m->dirty_list[m->dirty_count++] = page;
+    update_fast_path(m, page);
+  }
+}
+
+// Drops every cached instruction with a byte in the page. The two slots just
+// before it can reach into it as well.
+void invalidate_code_page(Machine* m, BYTE page)
+{
+  WORD start = (WORD)page << 8;
+  for (int i = 0; i < 256; i++)
+  {
+    m->decode_cache[(WORD)(start + i)].length = 0;
+  }
+  m->decode_cache[(WORD)(start - 1)].length = 0;
+  m->decode_cache[(WORD)(start - 2)].length = 0;
+  m->code_page[page] = 0;
+  m->page_gen[page]++;
+  m->code_dirty = 1;
+  update_fast_path(m, page);
+}
+
+void map_pages(Machine* m, WORD start, WORD end, BYTE type, BYTE* base)
+{
+  for (int page = start >> 8; page <= end >> 8; page++)
+  {
+    m->page_type[page] = type;
+    m->host_page[page] = base == NULL ? NULL : base + ((page - (start >> 8)) << 8);
+    m->io_read[page] = NULL;
+    m->io_write[page] = NULL;
+    m->io_context[page] = NULL;
+    // Whatever was decoded from the old mapping is gone.
+    invalidate_code_page(m, page);
+  }
+  // Pages that just became RAM are not tracked, the next restore copies everything.
+  m->baseline = 0;
+}
+
+void machine_map_ram(Machine* m, WORD start, WORD end)
+{
+  map_pages(m, start, end, PAGE_RAM, m->memory + (start & 0xFF00));
+}
+
+void machine_map_rom(Machine* m, WORD start, WORD end, const BYTE* image)
+{
+  map_pages(m, start, end, PAGE_ROM, image == NULL ? m->memory + (start & 0xFF00) : (BYTE*)image);
+}
+
+void machine_map_io(Machine* m, WORD start, WORD end, IoRead read, IoWrite write, void* context)
+{
+  map_pages(m, start, end, PAGE_IO, NULL);
+  for (int page = start >> 8; page <= end >> 8; page++)
+  {
+    m->io_read[page] = read;
+    m->io_write[page] = write;
+    m->io_context[page] = context;
+  }
+}
+
+#ifdef JOURNAL
+void machine_set_journal(Machine* m, Journal* j)
+{
+  m->journal = j;
+  for (int page = 0; page < 256; page++)
+  {
+    update_fast_path(m, page);
+  }
+}
+#endif
+
+Machine* machine_create(void)
+{
+  Machine* m = calloc(1, sizeof(Machine));
+  if (m != NULL)
+  {
+    machine_map_ram(m, 0x0000, 0xFFFF);
+  }
+  return m;
+}
+
+void machine_destroy(Machine* m)
+{
+  free(m);
+}
+
+// Starts tracking writes against snapshot id.
+void set_baseline(Machine* m, unsigned long id)
+{
+  m->baseline = id;
+  m->dirty_count = 0;
+  for (int page = 0; page < 256; page++)
+  {
+    m->clean_page[page] = m->page_type[page] == PAGE_RAM;
+    update_fast_path(m, page);
+  }
+}
+
+Snapshot* snapshot_create(Machine* m)
+{
+  static atomic_ulong next_id = 1;
+  Snapshot* s = malloc(sizeof(Snapshot));
+  if (s != NULL)
+  {
+    s->id = atomic_fetch_add(&next_id, 1);
+    s->cpu = m->cpu;
+    s->cycles = m->cycles;
+    s->instructions = m->instructions;
+    memcpy(s->memory, m->memory, sizeof s->memory);
+    set_baseline(m, s->id);
+  }
+  return s;
+}
+
+void snapshot_restore(Machine* m, const Snapshot* s)
+{
+  m->cpu = s->cpu;
+  m->cycles = s->cycles;
+  m->instructions = s->instructions;
+  if (m->baseline != s->id)
+  {
+    memcpy(m->memory, s->memory, sizeof m->memory);
+    for (int page = 0; page < 256; page++)
+    {
+      if (m->code_page[page])
+      {
+        invalidate_code_page(m, page);
+      }
+    }
+    set_baseline(m, s->id);
+    return;
+  }
+  for (int i = 0; i < m->dirty_count; i++)
+  {
+    BYTE page = m->dirty_list[i];
+    memcpy(m->memory + (page << 8), s->memory + (page << 8), 256);
+    if (m->code_page[page])
+    {
+      invalidate_code_page(m, page);
+    }
+    m->clean_page[page] = m->page_type[page] == PAGE_RAM;
+    update_fast_path(m, page);
+  }
+  m->dirty_count = 0;
+}
+
+void snapshot_destroy(Snapshot* s)
+{
+  free(s);
+}
+
+// Stops the run after this instruction. code_dirty makes a running block give
+// control back, so the limits get checked next.
+static void watch_hit(Machine* m, WORD address, BYTE kind)
+{
+  m->watch_hit = kind;
+  m->watch_address = address;
+  m->code_dirty = 1;
+}
+
+// Ends the run after this instruction, so run() gets to the events and
+// interrupts.
+static void stop_soon(Machine* m)
+{
+  m->deadline = 0;
+  m->code_dirty = 1;
+}
+
+NOINLINE BYTE mem_read_slow(Machine* m, WORD address)
+{
+  BYTE page = address >> 8;
+  if (ADDRESS_BIT(m->watch_read, address))
+  {
+    watch_hit(m, address, WATCH_READ);
+  }
+  if (m->page_type[page] == PAGE_IO && m->io_read[page] != NULL)
+  {
+#ifdef IDLE_SKIP
+    m->io_reads++;
+#endif
+    return m->io_read[page](m->io_context[page], address);
+  }
+  // Memory pages only come here while watched.
+  const BYTE* host = m->host_page[page];
+  return host != NULL ? host[address & 0xFF] : 0xFF;
+}
+
+BYTE mem_peek(const Machine* m, WORD address)
+{
+  const BYTE* page = m->host_page[address >> 8];
+  return page != NULL ? page[address & 0xFF] : 0xFF;
+}
+
+BYTE mem_read(Machine* m, WORD address)
+{
+  const BYTE* page = m->read_page[address >> 8];
+  if (page != NULL)
+  {
+    return page[address & 0xFF];
+  }
+  return mem_read_slow(m, address);
+}
+
+NOINLINE void mem_write_slow(Machine* m, WORD address, BYTE value)
+{
+  BYTE page = address >> 8;
+  if (ADDRESS_BIT(m->watch_write, address))
+  {
+    watch_hit(m, address, WATCH_WRITE);
+  }
+  switch (m->page_type[page])
+  {
+  case PAGE_RAM:
+    if (m->code_page[page])
+    {
+      invalidate_code_page(m, page);
+    }
+    mark_dirty(m, page);
+#ifdef JOURNAL
+    // Calling out last, nothing has to survive the call.
+    if (m->journal != NULL)
+    {
+      BYTE old = m->host_page[page][address & 0xFF];
+      m->host_page[page][address & 0xFF] = value;
+      journal_write(m->journal, address, old);
+      break;
+    }
+#endif
+    m->host_page[page][address & 0xFF] = value;
+    break;
+  case PAGE_IO:
+    if (m->io_write[page] != NULL)
+    {
+      m->io_write[page](m->io_context[page], address, value);
+    }
+    break;
+  }
+}
+
+void mem_load(Machine* m, WORD address, const BYTE* data, size_t size)
+{
+  if (size == 0)
+  {
+    return;
+  }
+  int last = (address + size - 1) >> 8;
+  for (int page = address >> 8; page <= last; page++)
+  {
+    if (m->code_page[page])
+    {
+      invalidate_code_page(m, page);
+    }
+    mark_dirty(m, page);
+  }
+  memcpy(m->memory + address, data, size);
+}
+
+void mem_write(Machine* m, WORD address, BYTE value)
+{
+  BYTE* page = m->write_page[address >> 8];
+  if (page != NULL)
+  {
+    page[address & 0xFF] = value;
+    return;
+  }
+  mem_write_slow(m, address, value);
+}
+
+// Instruction bytes, which do not trip read watchpoints.
+static BYTE fetch(Machine* m, WORD address)
+{
+  const BYTE* page = m->host_page[address >> 8];
+  return page != NULL ? page[address & 0xFF] : mem_read(m, address);
+}
+
+const Decoded* decode(Machine* m, WORD pc)
+{
+  Decoded* d = &m->decode_cache[pc];
+  if (!CODE_CACHEABLE(m, pc))
+  {
+    // Fetching from a device: read it every time.
+    d = &m->uncached;
+    d->length = 0;
+  }
+  if (d->length == 0)
+  {
+    d->op_code = fetch(m, pc);
+    d->length = instruction_length[d->op_code];
+    d->operand = 0;
+    if (d->length > 1)
+    {
+      d->operand = fetch(m, (WORD)(pc + 1));
+    }
+    if (d->length > 2)
+    {
+      d->operand |= (WORD)fetch(m, (WORD)(pc + 2)) << 8;
+    }
+    if (d != &m->uncached)
+    {
+      // Writes into these pages have to go through mem_write_slow() from now on.
+      m->code_page[pc >> 8] = 1;
+      m->code_page[(WORD)(pc + d->length - 1) >> 8] = 1;
+      update_fast_path(m, pc >> 8);
+      update_fast_path(m, (WORD)(pc + d->length - 1) >> 8);
+    }
+  }
+  return d;
+}
+void cpu_reset(Machine* m)
+{
+  CPU* cpu = &m->cpu;
+  cpu->S = 0xFD;
+  BYTE low = mem_read(m, 0xFFFC);
+  BYTE high = mem_read(m, 0xFFFD);
+  cpu->PC = ((WORD)high << 8) | low;
+  cpu->A = cpu->X = cpu->Y = 0;
+  cpu->P.U = 1;
+  cpu->P.I = 1;
+  m->nmi = 0;
+#ifdef LAZY_FLAGS
+  SET_N(cpu, 0);
+  SET_Z(cpu, 1);
+  SET_CARRY(cpu, 0);
+  SET_OVERFLOW(cpu, 0);
+#endif
+}
+
+void cpu_reset_to(Machine* m, WORD start)
+{
+  BYTE vector[2] = {start & 0xFF, start >> 8};
+  mem_load(m, VECTOR_RESET, vector, sizeof vector);
+  cpu_reset(m);
+  m->cpu.PC = start;
+}
+
+void setZN(CPU* cpu, BYTE val)
+{
+#ifdef LAZY_FLAGS
+  cpu->n_result = cpu->z_result = val;
+#else
+  cpu->P.Z = (val == 0);
+  cpu->P.N = (val & 0x80) != 0;
+  cpu->P.U = 1;
+#endif
+}
+// Carry in/out through C. Decimal mode works like on the NMOS part: N and V
+// come from the sum before its high digit is adjusted, Z from the binary sum.
+void adc(CPU* cpu, BYTE val)
+{
+  WORD result = cpu->A + GET_C(cpu) + val;
+  if (cpu->P.D)
+  {
+    int low = (cpu->A & 0x0F) + (val & 0x0F) + GET_C(cpu);
+    if (low >= 0x0A)
+    {
+      low = ((low + 0x06) & 0x0F) + 0x10;
+    }
+    int sum = (cpu->A & 0xF0) + (val & 0xF0) + low;
+    SET_Z(cpu, (BYTE)result);
+    SET_N(cpu, sum);
+    SET_OVERFLOW(cpu, ~(cpu->A ^ val) & (cpu->A ^ sum));
+    if (sum >= 0xA0)
+    {
+      sum += 0x60;
+    }
+    SET_CARRY(cpu, (sum >= 0x100) << 8);
+    cpu->A = (BYTE)sum;
+    return;
+  }
+  SET_CARRY(cpu, result);
+  // Overflow (V) is set when (+) + (+) = - or (-) + (-) = +
+  // We detect it by looking at the sign bit (bit 7).
+  // A ^ val tells if the signs of A and operand differ (1 = different, 0 = same)
+  // Negate it (~) now 1 indicates the operands have the same sign
+  // A ^ result tells if the result’s sign differs from A (1 = sign changed)
+  // AND both conditions will give 1 if same-sign operands produced a sign-flipped result
+  // & 0x80 to isolate the sign bit for the V flag
+  SET_OVERFLOW(cpu, ~(cpu->A ^ val) & (cpu->A ^ (BYTE)(result)));
+  cpu->A = (BYTE)(result);
+  setZN(cpu, cpu->A);
+}
+
+// A - val - borrow, where C set means no borrow. In decimal mode the flags are
+// still the binary ones.
+void sbc(CPU* cpu, BYTE val)
+{
+  BYTE a = cpu->A;
+  BYTE borrow = !GET_C(cpu);
+  WORD result = a + (BYTE)~val + !borrow;
+  SET_CARRY(cpu, result);
+  SET_OVERFLOW(cpu, (a ^ val) & (a ^ (BYTE)result));
+  cpu->A = (BYTE)result;
+  setZN(cpu, cpu->A);
+  if (cpu->P.D)
+  {
+    int low = (a & 0x0F) - (val & 0x0F) - borrow;
+    if (low < 0)
+    {
+      low = ((low - 0x06) & 0x0F) - 0x10;
+    }
+    int diff = (a & 0xF0) - (val & 0xF0) + low;
+    if (diff < 0)
+    {
+      diff -= 0x60;
+    }
+    cpu->A = (BYTE)diff;
+  }
+}
+
+// CMP, CPX and CPY: flags of reg - val, C set when reg >= val.
+void compare(CPU* cpu, BYTE reg, BYTE val)
+{
+  WORD result = reg + (BYTE)~val + 1;
+  SET_CARRY(cpu, result);
+  setZN(cpu, (BYTE)result);
+}
+
+// What PLP and RTI load. B does not exist in the register, U always reads 1.
+void set_status_byte(CPU* cpu, BYTE value)
+{
+  SET_N(cpu, value);
+  SET_OVERFLOW(cpu, value << 1);
+  SET_Z(cpu, !(value & 0x02));
+  SET_CARRY(cpu, (value & 0x01) << 8);
+  cpu->P.D = (value >> 3) & 1;
+  cpu->P.I = (value >> 2) & 1;
+  cpu->P.U = 1;
+}
+
+void cpu_set_status_byte(CPU* cpu, BYTE value)
+{
+  set_status_byte(cpu, value);
+}
+void cpu_adc(CPU* cpu, BYTE value)
+{
+  adc(cpu, value);
+}
+void cpu_sbc(CPU* cpu, BYTE value)
+{
+  sbc(cpu, value);
+}
+
+// The stack lives in page 1, S points at the next free byte.
+void push(Machine* m, BYTE value)
+{
+  mem_write(m, 0x0100 | m->cpu.S--, value);
+}
+
+BYTE pull(Machine* m)
+{
+  return mem_read(m, 0x0100 | ++m->cpu.S);
+}
+
+// Taken branches cost one more cycle, two if they land in another page.
+void take_branch(Machine* m, SBYTE offset)
+{
+  WORD target = (m->cpu.PC + offset) & 0xFFFF;
+  m->cycles += 1 + PAGE_CROSSED(m->cpu.PC, target);
+  m->cpu.PC = target;
+}
+
+#ifdef COVERAGE
+static inline void cover_edge(Coverage* c, WORD edge)
+{
+  BYTE count = c->map[edge];
+  if (count == 0)
+  {
+    c->hit[c->hit_count++] = edge;
+  }
+  c->map[edge] = count + 1 + (count == 255);
+}
+#endif
+
+// base + index. An indexed read that crosses a page costs a cycle more, which
+// penalty says whether to charge.
+static inline WORD indexed(Machine* m, WORD base, BYTE index, int penalty)
+{
+  WORD addr = base + index;
+  if (penalty)
+  {
+    m->cycles += PAGE_CROSSED(base, addr);
+  }
+  return addr;
+}
+
+// The pointers of (zp,X) and (zp),Y wrap around within page zero.
+static inline WORD zeropage_pointer(Machine* m, BYTE ptr)
+{
+  BYTE low = mem_read(m, ptr);
+  return (mem_read(m, (BYTE)(ptr + 1)) << 8) | low;
+}
+
+// JMP ($10FF) reads its high byte from $1000, the pointer never leaves its page.
+static inline WORD indirect_pointer(Machine* m, WORD ptr)
+{
+  BYTE low = mem_read(m, ptr);
+  return (mem_read(m, (ptr & 0xFF00) | (BYTE)(ptr + 1)) << 8) | low;
+}
+// Control flow, the last instruction of a block. The profiler uses it too.
+const BYTE ends_block[256] = {
+    [BCC] = 1, [BCS] = 1, [BEQ] = 1, [BMI] = 1, [BNE] = 1,
+    [BPL] = 1, [BVC] = 1, [BVS] = 1, [BRK] = 1,
+    [JMP_ABSOLUTE] = 1, [JMP_INDIRECT] = 1, [JSR] = 1, [RTS] = 1, [RTI] = 1,
+};
+#ifdef IDLE_SKIP
+// Instructions that write memory, the stack included.
+static const BYTE writes_memory[256] = {
+    [STA_ZEROPAGE] = 1,   [STA_ZEROPAGE_X] = 1, [STA_ABSOLUTE] = 1,   [STA_ABSOLUTE_X] = 1,
+    [STA_ABSOLUTE_Y] = 1, [STA_INDIRECT_X] = 1, [STA_INDIRECT_Y] = 1, [STX_ZEROPAGE] = 1,
+    [STX_ZEROPAGE_Y] = 1, [STX_ABSOLUTE] = 1,   [STY_ZEROPAGE] = 1,   [STY_ZEROPAGE_X] = 1,
+    [STY_ABSOLUTE] = 1,   [INC_ZEROPAGE] = 1,   [INC_ZEROPAGE_X] = 1, [INC_ABSOLUTE] = 1,
+    [INC_ABSOLUTE_X] = 1, [DEC_ZEROPAGE] = 1,   [DEC_ZEROPAGE_X] = 1, [DEC_ABSOLUTE] = 1,
+    [DEC_ABSOLUTE_X] = 1, [ASL_ZEROPAGE] = 1,   [ASL_ZEROPAGE_X] = 1, [ASL_ABSOLUTE] = 1,
+    [ASL_ABSOLUTE_X] = 1, [LSR_ZEROPAGE] = 1,   [LSR_ZEROPAGE_X] = 1, [LSR_ABSOLUTE] = 1,
+    [LSR_ABSOLUTE_X] = 1, [ROL_ZEROPAGE] = 1,   [ROL_ZEROPAGE_X] = 1, [ROL_ABSOLUTE] = 1,
+    [ROL_ABSOLUTE_X] = 1, [ROR_ZEROPAGE] = 1,   [ROR_ZEROPAGE_X] = 1, [ROR_ABSOLUTE] = 1,
+    [ROR_ABSOLUTE_X] = 1, [PHA] = 1,            [PHP] = 1,
+};
+
+// Whether start..end - 1 runs straight into a jump at its end and writes no
+// memory on the way. Idle loops are short, longer ones are not looked at.
+static int quiet_loop(Machine* m, WORD start, WORD end)
+{
+  WORD pc = start;
+  for (int i = 0; i < 16; i++)
+  {
+    const Decoded* d = decode(m, pc);
+    if (writes_memory[d->op_code])
+    {
+      return 0;
+    }
+    pc += d->length;
+    if (ends_block[d->op_code])
+    {
+      return pc == end;
+    }
+  }
+  return 0;
+}
+
+// Jumps backwards are only looked at now and then, in pairs: one records
+// where it went and the state, the next one compares.
+#define IDLE_SAMPLE 64
+
+// Called with target, where the jump went, end just past the jump and done the
+// instructions run so far. If the jump came back to where the last one went,
+// with the same registers, no device read in between and over code that
+// writes nothing, the loop can only go round the same way until something
+// from outside changes. As many whole trips as fit before the budget or the
+// deadline then get counted without running them. Returns the instructions
+// skipped.
+static unsigned long skip_idle_loop(Machine* m, WORD target, WORD end, unsigned long long done,
+                                    unsigned long count, unsigned long long deadline)
+{
+  CPU* cpu = &m->cpu;
+  CPU* last = &m->idle_cpu;
+  if (!m->idle_armed)
+  {
+    m->idle_armed = 1;
+    m->idle_countdown = 0;
+    m->idle_pc = target;
+    *last = *cpu;
+    m->idle_cycles = m->cycles;
+    m->idle_instructions = done;
+    m->idle_io_reads = m->io_reads;
+    return 0;
+  }
+  m->idle_armed = 0;
+  m->idle_countdown = IDLE_SAMPLE;
+  int watched = 0;
+#ifdef TRACE
+  watched |= m->trace != NULL;
+#endif
+#ifdef PROFILE
+  watched |= m->profile != NULL;
+#endif
+#ifdef COVERAGE
+  // Skipped trips would not bump their edges' hit counts.
+  watched |= m->coverage != NULL;
+#endif
+  if (m->idle_pc != target || m->idle_io_reads != m->io_reads || cpu->A != last->A ||
+      cpu->X != last->X || cpu->Y != last->Y || cpu->S != last->S ||
+      cpu_status_byte(cpu) != cpu_status_byte(last) || watched || count == 0 ||
+      m->cycles >= deadline || !quiet_loop(m, target, end))
+  {
+    return 0;
+  }
+  // Stop short of both limits, the rest runs normally and stops where it
+  // would have anyway.
+  unsigned long instructions = done - m->idle_instructions;
+  unsigned long long cycles = m->cycles - m->idle_cycles;
+  unsigned long trips = (count - 1) / instructions;
+  if ((deadline - m->cycles - 1) / cycles < trips)
+  {
+    trips = (deadline - m->cycles - 1) / cycles;
+  }
+  m->cycles += trips * cycles;
+  return trips * instructions;
+}
+#endif
+#ifdef BLOCK_CACHE
+
+void translate_block(Machine* m, Block* b, WORD pc)
+{
+  b->start = pc;
+  b->count = 0;
+  b->cycles = b->max_cycles = 0;
+  do
+  {
+    const Decoded* d = decode(m, pc);
+    b->insn[b->count++] = *d;
+    b->cycles += base_cycles[d->op_code];
+    b->max_cycles += base_cycles[d->op_code] + max_penalty[d->op_code];
+    pc += d->length;
+  } while (b->count < BLOCK_MAX_INSNS && !ends_block[b->insn[b->count - 1].op_code] &&
+           !BREAKPOINT_AT(m, pc) && CODE_CACHEABLE(m, pc));
+  b->end = pc - 1;
+  // decode() never invalidates, so the generations are still the ones the
+  // instructions were read under.
+  b->gen[0] = m->page_gen[b->start >> 8];
+  b->gen[1] = m->page_gen[b->end >> 8];
+}
+
+// Charges the block's instructions and base cycles in one go. If that could
+// run past either budget, only its first instruction is handed out instead.
+const Decoded* enter_block(Machine* m, WORD pc, unsigned* remaining, unsigned long count,
+                           unsigned long long deadline)
+{
+  Block* b = &m->block_cache[pc & (BLOCK_CACHE_SIZE - 1)];
+  m->code_dirty = 0;
+  m->running = NULL;
+  *remaining = 1;
+  if (!CODE_CACHEABLE(m, pc))
+  {
+    const Decoded* d = decode(m, pc);
+    m->cycles += base_cycles[d->op_code];
+    return d;
+  }
+  if (b->count == 0 || b->start != pc || b->gen[0] != m->page_gen[b->start >> 8] ||
+      b->gen[1] != m->page_gen[b->end >> 8])
+  {
+    translate_block(m, b, pc);
+  }
+  if (b->count > count || deadline - m->cycles < b->max_cycles)
+  {
+    m->cycles += base_cycles[b->insn[0].op_code];
+    return b->insn;
+  }
+  *remaining = b->count;
+  m->cycles += b->cycles;
+  m->running = b;
+  return b->insn;
+}
+
+// Takes back the base cycles charged for n instructions that never ran.
+void refund_cycles(Machine* m, const Decoded* d, unsigned n)
+{
+  m->running = NULL;
+  for (; n != 0; n--, d++)
+  {
+    m->cycles -= base_cycles[d->op_code];
+  }
+}
+#endif
+// What every handler is made of. ADDRESS_<mode> leaves the effective address
+// in addr, READ_<mode> and WRITE_<mode> get at the operand and
+// EXECUTE_<mnemonic> does the rest. They use execute()'s m, cpu, operand and d.
+// penalty comes from the opcode table; only indexed reads pay for a crossing.
+#define ADDRESS_IMPLIED(penalty)
+#define ADDRESS_ACCUMULATOR(penalty)
+#define ADDRESS_IMMEDIATE(penalty)
+#define ADDRESS_RELATIVE(penalty)
+#define ADDRESS_ZEROPAGE(penalty) WORD addr = (BYTE)operand
+#define ADDRESS_ZEROPAGE_X(penalty) WORD addr = (BYTE)(operand + cpu->X)
+#define ADDRESS_ZEROPAGE_Y(penalty) WORD addr = (BYTE)(operand + cpu->Y)
+#define ADDRESS_ABSOLUTE(penalty) WORD addr = operand
+#define ADDRESS_ABSOLUTE_X(penalty) WORD addr = indexed(m, operand, cpu->X, penalty)
+#define ADDRESS_ABSOLUTE_Y(penalty) WORD addr = indexed(m, operand, cpu->Y, penalty)
+#define ADDRESS_INDIRECT(penalty) WORD addr = indirect_pointer(m, operand)
+#define ADDRESS_INDIRECT_X(penalty) WORD addr = zeropage_pointer(m, (BYTE)(operand + cpu->X))
+#define ADDRESS_INDIRECT_Y(penalty)                                                                \
+  WORD addr = indexed(m, zeropage_pointer(m, (BYTE)operand), cpu->Y, penalty)
+
+#define READ_ACCUMULATOR cpu->A
+#define READ_IMMEDIATE (BYTE)operand
+#define READ_ZEROPAGE mem_read(m, addr)
+#define READ_ZEROPAGE_X mem_read(m, addr)
+#define READ_ZEROPAGE_Y mem_read(m, addr)
+#define READ_ABSOLUTE mem_read(m, addr)
+#define READ_ABSOLUTE_X mem_read(m, addr)
+#define READ_ABSOLUTE_Y mem_read(m, addr)
+#define READ_INDIRECT_X mem_read(m, addr)
+#define READ_INDIRECT_Y mem_read(m, addr)
+
+#define WRITE_ACCUMULATOR(value) cpu->A = (value)
+#define WRITE_ZEROPAGE(value) mem_write(m, addr, (value))
+#define WRITE_ZEROPAGE_X(value) mem_write(m, addr, (value))
+#define WRITE_ZEROPAGE_Y(value) mem_write(m, addr, (value))
+#define WRITE_ABSOLUTE(value) mem_write(m, addr, (value))
+#define WRITE_ABSOLUTE_X(value) mem_write(m, addr, (value))
+#define WRITE_ABSOLUTE_Y(value) mem_write(m, addr, (value))
+#define WRITE_INDIRECT_X(value) mem_write(m, addr, (value))
+#define WRITE_INDIRECT_Y(value) mem_write(m, addr, (value))
+
+// Loads, stores and register transfers.
+#define LOAD(reg, mode)                                                                            \
+  cpu->reg = READ_##mode;                                                                          \
+  setZN(cpu, cpu->reg)
+#define TRANSFER(to, from)                                                                         \
+  cpu->to = cpu->from;                                                                             \
+  setZN(cpu, cpu->to)
+#define EXECUTE_LDA(mode) LOAD(A, mode)
+#define EXECUTE_LDX(mode) LOAD(X, mode)
+#define EXECUTE_LDY(mode) LOAD(Y, mode)
+#define EXECUTE_STA(mode) WRITE_##mode(cpu->A)
+#define EXECUTE_STX(mode) WRITE_##mode(cpu->X)
+#define EXECUTE_STY(mode) WRITE_##mode(cpu->Y)
+#define EXECUTE_TAX(mode) TRANSFER(X, A)
+#define EXECUTE_TAY(mode) TRANSFER(Y, A)
+#define EXECUTE_TSX(mode) TRANSFER(X, S)
+#define EXECUTE_TXA(mode) TRANSFER(A, X)
+#define EXECUTE_TYA(mode) TRANSFER(A, Y)
+#define EXECUTE_TXS(mode) cpu->S = cpu->X
+
+// Arithmetic and logic on A.
+#define LOGIC(op, mode)                                                                            \
+  cpu->A op READ_##mode;                                                                           \
+  setZN(cpu, cpu->A)
+#define EXECUTE_AND(mode) LOGIC(&=, mode)
+#define EXECUTE_ORA(mode) LOGIC(|=, mode)
+#define EXECUTE_EOR(mode) LOGIC(^=, mode)
+#define EXECUTE_ADC(mode) adc(cpu, READ_##mode)
+#define EXECUTE_SBC(mode) sbc(cpu, READ_##mode)
+#define EXECUTE_CMP(mode) compare(cpu, cpu->A, READ_##mode)
+#define EXECUTE_CPX(mode) compare(cpu, cpu->X, READ_##mode)
+#define EXECUTE_CPY(mode) compare(cpu, cpu->Y, READ_##mode)
+#define EXECUTE_BIT(mode)                                                                          \
+  BYTE val = READ_##mode;                                                                          \
+  SET_Z(cpu, val & cpu->A);                                                                        \
+  SET_N(cpu, val);                                                                                 \
+  SET_OVERFLOW(cpu, val << 1)
+
+// Read-modify-write, on memory or on A.
+#define EXECUTE_INC(mode)                                                                          \
+  BYTE val = READ_##mode + 1;                                                                      \
+  WRITE_##mode(val);                                                                               \
+  setZN(cpu, val)
+#define EXECUTE_DEC(mode)                                                                          \
+  BYTE val = READ_##mode - 1;                                                                      \
+  WRITE_##mode(val);                                                                               \
+  setZN(cpu, val)
+#define EXECUTE_ASL(mode)                                                                          \
+  BYTE val = READ_##mode;                                                                          \
+  SET_CARRY(cpu, val << 1);                                                                        \
+  val = val << 1;                                                                                  \
+  WRITE_##mode(val);                                                                               \
+  setZN(cpu, val)
+#define EXECUTE_LSR(mode)                                                                          \
+  BYTE val = READ_##mode;                                                                          \
+  SET_CARRY(cpu, val << 8);                                                                        \
+  val = val >> 1;                                                                                  \
+  WRITE_##mode(val);                                                                               \
+  setZN(cpu, val)
+#define EXECUTE_ROL(mode)                                                                          \
+  BYTE val = READ_##mode;                                                                          \
+  WORD result = (val << 1) | GET_C(cpu);                                                           \
+  SET_CARRY(cpu, result);                                                                          \
+  val = (BYTE)result;                                                                              \
+  WRITE_##mode(val);                                                                               \
+  setZN(cpu, val)
+#define EXECUTE_ROR(mode)                                                                          \
+  BYTE val = READ_##mode;                                                                          \
+  BYTE result = (val >> 1) | (GET_C(cpu) << 7);                                                    \
+  SET_CARRY(cpu, val << 8);                                                                        \
+  val = result;                                                                                    \
+  WRITE_##mode(val);                                                                               \
+  setZN(cpu, val)
+#define STEP(reg, delta)                                                                           \
+  cpu->reg = cpu->reg + (delta);                                                                   \
+  setZN(cpu, cpu->reg)
+#define EXECUTE_INX(mode) STEP(X, 1)
+#define EXECUTE_INY(mode) STEP(Y, 1)
+#define EXECUTE_DEX(mode) STEP(X, -1)
+#define EXECUTE_DEY(mode) STEP(Y, -1)
+
+// Branches, jumps and the stack. The coverage edge is the address after the
+// branch hashed with wherever it went, so taken and not taken count apart.
+#ifdef COVERAGE
+#define COVER_EDGE(from)                                                                           \
+  if (m->coverage != NULL)                                                                         \
+  {                                                                                                \
+    cover_edge(m->coverage, (from) >> 1 ^ cpu->PC);                                                \
+  }
+#else
+#define COVER_EDGE(from)
+#endif
+#ifdef IDLE_SKIP
+#define LOOP_BACK(target, end)                                                                     \
+  if ((target) < (end) && m->idle_countdown-- == 0)                                                \
+  {                                                                                                \
+    count -= skip_idle_loop(m, target, end, m->instructions + budget - count, count,               \
+                            m->deadline);                                                          \
+  }
+#else
+#define LOOP_BACK(target, end)
+#endif
+#define BRANCH(taken)                                                                              \
+  if (taken)                                                                                       \
+  {                                                                                                \
+    take_branch(m, (SBYTE)operand);                                                                \
+    COVER_EDGE((WORD)(cpu->PC - (SBYTE)operand));                                                  \
+    LOOP_BACK(cpu->PC, (WORD)(cpu->PC - (SBYTE)operand));                                          \
+  }                                                                                                \
+  else                                                                                             \
+  {                                                                                                \
+    COVER_EDGE(cpu->PC);                                                                           \
+  }
+#define EXECUTE_BCC(mode) BRANCH(GET_C(cpu) == 0)
+#define EXECUTE_BCS(mode) BRANCH(GET_C(cpu) == 1)
+#define EXECUTE_BNE(mode) BRANCH(GET_Z(cpu) == 0)
+#define EXECUTE_BEQ(mode) BRANCH(GET_Z(cpu) == 1)
+#define EXECUTE_BPL(mode) BRANCH(GET_N(cpu) == 0)
+#define EXECUTE_BMI(mode) BRANCH(GET_N(cpu) == 1)
+#define EXECUTE_BVC(mode) BRANCH(GET_V(cpu) == 0)
+#define EXECUTE_BVS(mode) BRANCH(GET_V(cpu) == 1)
+#define EXECUTE_JMP(mode)                                                                          \
+  LOOP_BACK(addr, cpu->PC);                                                                        \
+  cpu->PC = addr
+// JSR pushes the address of its own last byte, RTS adds the 1 back.
+#define EXECUTE_JSR(mode)                                                                          \
+  push(m, (WORD)(cpu->PC - 1) >> 8);                                                               \
+  push(m, (BYTE)(cpu->PC - 1));                                                                    \
+  cpu->PC = addr
+// Clearing I while the IRQ line is held lets the interrupt in after this
+// instruction.
+#define UNMASKED()                                                                                 \
+  if (m->irq != 0 && !cpu->P.I)                                                                    \
+  {                                                                                                \
+    stop_soon(m);                                                                                  \
+  }
+#define EXECUTE_RTS(mode)                                                                          \
+  BYTE low = pull(m);                                                                              \
+  cpu->PC = ((pull(m) << 8) | low) + 1
+#define EXECUTE_RTI(mode)                                                                          \
+  set_status_byte(cpu, pull(m));                                                                   \
+  BYTE low = pull(m);                                                                              \
+  cpu->PC = (pull(m) << 8) | low;                                                                  \
+  UNMASKED()
+#define EXECUTE_PHA(mode) push(m, cpu->A)
+#define EXECUTE_PLA(mode)                                                                          \
+  cpu->A = pull(m);                                                                                \
+  setZN(cpu, cpu->A)
+// The pushed copy always has B and bit 5 set.
+#define EXECUTE_PHP(mode) push(m, cpu_status_byte(cpu) | 0x30)
+#define EXECUTE_PLP(mode)                                                                          \
+  set_status_byte(cpu, pull(m));                                                                   \
+  UNMASKED()
+// Without brk_interrupt BRK stops the run instead, see StopReason.
+#define EXECUTE_BRK(mode)                                                                          \
+  if (!m->brk_interrupt)                                                                           \
+  {                                                                                                \
+    cpu->PC -= d->length;                                                                          \
+    UNCHARGE();                                                                                    \
+    STOP(STOP_BRK);                                                                                \
+  }                                                                                                \
+  /* PC is already past the padding byte. */                                                       \
+  push(m, cpu->PC >> 8);                                                                           \
+  push(m, cpu->PC & 0xFF);                                                                         \
+  push(m, cpu_status_byte(cpu) | 0x30);                                                            \
+  cpu->P.I = 1;                                                                                    \
+  cpu->PC = indirect_pointer(m, 0xFFFE)
+
+// Flags.
+#define EXECUTE_CLC(mode) SET_CARRY(cpu, 0)
+#define EXECUTE_SEC(mode) SET_CARRY(cpu, 0x100)
+#define EXECUTE_CLV(mode) SET_OVERFLOW(cpu, 0)
+#define EXECUTE_CLD(mode) cpu->P.D = 0
+#define EXECUTE_SED(mode) cpu->P.D = 1
+#define EXECUTE_CLI(mode)                                                                          \
+  cpu->P.I = 0;                                                                                    \
+  UNMASKED()
+#define EXECUTE_SEI(mode) cpu->P.I = 1
+#define EXECUTE_NOP(mode)
+
+// OP() opens a handler, NEXT ends it, ILLEGAL gets every opcode nobody claimed.
+// With THREADED_DISPATCH every handler jumps to the next one itself through
+// dispatch_table (computed goto, GCC/Clang only). Otherwise it is the plain switch.
+#if defined(THREADED_DISPATCH) && !defined(__GNUC__)
+#undef THREADED_DISPATCH
+#endif
+// Runs until budget instructions are done or m->cycles reaches m->deadline.
+// Instructions and cycles are both charged before anything runs: a whole block
+// at a time with BLOCK_CACHE, one instruction at a time without. Handlers only
+// add the penalties. Both budgets are checked where the charging happens.
+StopReason execute(Machine* m, unsigned long budget)
+{
+  CPU* cpu = &m->cpu;
+  // Always set by the first FETCH(), GCC cannot see that through the switch.
+  const Decoded* d = NULL;
+  BYTE op_code;
+  WORD operand;
+  unsigned long count = budget;
+#ifdef BLOCK_CACHE
+  unsigned remaining = 1;
+#endif
+  m->watch_hit = 0;
+#ifdef IDLE_SKIP
+  // Whatever happened between runs may have changed what loops read.
+  m->idle_armed = 0;
+#endif
+#define STOP(reason)                                                                               \
+  m->instructions += budget - count;                                                               \
+  return reason
+// PC already points past the instruction when the handler runs; its operand
+// bytes come from the decode cache. Breakpoints always start a block, so with
+// BLOCK_CACHE they only get looked at on block entry.
+#define CHECK_LIMITS()                                                                             \
+  if (m->watch_hit)                                                                                \
+  {                                                                                                \
+    STOP(STOP_WATCHPOINT);                                                                         \
+  }                                                                                                \
+  if (count == 0 || m->cycles >= m->deadline)                                                      \
+  {                                                                                                \
+    STOP(STOP_BUDGET);                                                                             \
+  }                                                                                                \
+  if (count != budget && BREAKPOINT_AT(m, cpu->PC))                                                \
+  {                                                                                                \
+    STOP(STOP_BREAKPOINT);                                                                         \
+  }
+#ifdef BLOCK_CACHE
+#define LOOKUP()                                                                                   \
+  if (--remaining == 0 || m->code_dirty)                                                           \
+  {                                                                                                \
+    if (remaining != 0)                                                                            \
+    {                                                                                              \
+      /* Code changed under the block, the rest of it gets translated again. */                    \
+      refund_cycles(m, d + 1, remaining);                                                          \
+      count += remaining;                                                                          \
+    }                                                                                              \
+    CHECK_LIMITS();                                                                                \
+    d = enter_block(m, cpu->PC, &remaining, count, m->deadline);                                   \
+    count -= remaining;                                                                            \
+  }                                                                                                \
+  else                                                                                             \
+  {                                                                                                \
+    d++;                                                                                           \
+  }
+// Whatever stops inside a block never ran, and neither did the rest of it.
+#define UNCHARGE()                                                                                 \
+  refund_cycles(m, d, remaining);                                                                  \
+  count += remaining
+#else
+#define LOOKUP()                                                                                   \
+  CHECK_LIMITS();                                                                                  \
+  d = decode(m, cpu->PC);                                                                          \
+  m->cycles += base_cycles[d->op_code];                                                            \
+  count--
+#define UNCHARGE()                                                                                 \
+  m->cycles -= base_cycles[d->op_code];                                                            \
+  count++
+#endif
+#ifdef TRACE
+#define RECORD()                                                                                   \
+  if (m->trace != NULL)                                                                            \
+  {                                                                                                \
+    trace_record(m->trace, m, d);                                                                  \
+  }
+#else
+#define RECORD()
+#endif
+#ifdef PROFILE
+#define COUNT()                                                                                    \
+  if (m->profile != NULL)                                                                          \
+  {                                                                                                \
+    Profile* p = m->profile;                                                                       \
+    p->op_count[d->op_code]++;                                                                     \
+    p->pc_count[cpu->PC]++;                                                                        \
+    if (p->leader)                                                                                 \
+    {                                                                                              \
+      p->block = cpu->PC;                                                                          \
+      p->block_entries[cpu->PC]++;                                                                 \
+    }                                                                                              \
+    p->block_insns[p->block]++;                                                                    \
+    p->leader = ends_block[d->op_code];                                                            \
+  }
+#else
+#define COUNT()
+#endif
+#define FETCH()                                                                                    \
+  LOOKUP();                                                                                        \
+  RECORD();                                                                                        \
+  COUNT();                                                                                         \
+  cpu->PC += d->length;                                                                            \
+  op_code = d->op_code;                                                                            \
+  operand = d->operand
+#ifdef THREADED_DISPATCH
+#define TARGET(name, code, ...) [code] = &&op_##name,
+#define NO_TARGET(code) [code] = &&op_illegal,
+  static void* const dispatch_table[256] = {OPCODE_TABLE(TARGET, NO_TARGET)};
+#undef TARGET
+#undef NO_TARGET
+#define OP(name) op_##name:
+#define NEXT                                                                                       \
+  FETCH();                                                                                         \
+  goto* dispatch_table[op_code]
+#define ILLEGAL op_illegal:
+  FETCH();
+  goto* dispatch_table[op_code];
+#else
+#define OP(name) case name:
+#define NEXT break
+#define ILLEGAL default:
+  for (;;)
+  {
+    FETCH();
+    switch (op_code)
+    {
+#endif
+  // One handler per opcode, see opcodes.h.
+#define HANDLER(name, code, mnemonic, mode, bytes, cycles, penalty, flags)                         \
+  OP(name)                                                                                         \
+  {                                                                                                \
+    ADDRESS_##mode(penalty);                                                                       \
+    EXECUTE_##mnemonic(mode);                                                                      \
+    NEXT;                                                                                          \
+  }
+#define NO_HANDLER(code)
+  OPCODE_TABLE(HANDLER, NO_HANDLER)
+#undef HANDLER
+#undef NO_HANDLER
+  ILLEGAL
+  {
+    cpu->PC -= d->length;
+    UNCHARGE();
+    STOP(STOP_ILLEGAL);
+  }
+#ifndef THREADED_DISPATCH
+    }
+  }
+#endif
+#undef CHECK_LIMITS
+#undef LOOKUP
+#undef UNCHARGE
+#undef STOP
+#undef RECORD
+#undef COUNT
+#undef FETCH
+#undef OP
+#undef NEXT
+#undef ILLEGAL
+}
+
+void cpu_interrupt(Machine* m, WORD vector)
+{
+  CPU* cpu = &m->cpu;
+  if (m->recording != NULL)
+  {
+    recording_interrupt(m->recording, m, vector);
+  }
+  push(m, cpu->PC >> 8);
+  push(m, cpu->PC & 0xFF);
+  push(m, (cpu_status_byte(cpu) | 0x20) & ~0x10);
+  cpu->P.I = 1;
+  cpu->PC = indirect_pointer(m, vector);
+  m->cycles += 7;
+#ifdef PROFILE
+  if (m->profile != NULL)
+  {
+    m->profile->leader = 1;
+  }
+#endif
+}
+
+void cpu_set_irq(Machine* m, unsigned sources, int asserted)
+{
+  if (asserted)
+  {
+    m->irq |= sources;
+  }
+  else
+  {
+    m->irq &= ~sources;
+  }
+  if (m->irq != 0 && !m->cpu.P.I)
+  {
+    stop_soon(m);
+  }
+}
+
+void cpu_nmi(Machine* m)
+{
+  m->nmi = 1;
+  stop_soon(m);
+}
+
+int machine_schedule(Machine* m, unsigned long long cycle, EventHandler handler, void* context)
+{
+  if (m->event_count == MAX_EVENTS)
+  {
+    return -1;
+  }
+  int i = m->event_count++;
+  for (; i > 0 && m->events[(i - 1) / 2].cycle > cycle; i = (i - 1) / 2)
+  {
+    m->events[i] = m->events[(i - 1) / 2];
+  }
+  m->events[i] = (Event){cycle, handler, context};
+  // A run in progress has to stop earlier now. Breaking the block makes it
+  // look at the deadline again.
+  if (cycle < m->deadline)
+  {
+    m->deadline = cycle;
+    m->code_dirty = 1;
+  }
+  return 0;
+}
+
+// Takes events[i] out of the heap. The last event fills the hole and moves up
+// or down from there.
+static void remove_event(Machine* m, int i)
+{
+  Event last = m->events[--m->event_count];
+  if (i == m->event_count)
+  {
+    return;
+  }
+  for (; i > 0 && m->events[(i - 1) / 2].cycle > last.cycle; i = (i - 1) / 2)
+  {
+    m->events[i] = m->events[(i - 1) / 2];
+  }
+  for (;;)
+  {
+    int child = 2 * i + 1;
+    if (child + 1 < m->event_count && m->events[child + 1].cycle < m->events[child].cycle)
+    {
+      child++;
+    }
+    if (child >= m->event_count || m->events[child].cycle >= last.cycle)
+    {
+      break;
+    }
+    m->events[i] = m->events[child];
+    i = child;
+  }
+  m->events[i] = last;
+}
+
+void machine_cancel(Machine* m, EventHandler handler, void* context)
+{
+  // Whatever moves into a hole comes from further back and has been looked at.
+  for (int i = m->event_count - 1; i >= 0; i--)
+  {
+    if (m->events[i].handler == handler && m->events[i].context == context)
+    {
+      remove_event(m, i);
+    }
+  }
+}
+
+// PC is already past the running instruction, so it tells which one of the
+// block that is.
+unsigned long long machine_now(const Machine* m)
+{
+  unsigned long long cycles = m->cycles;
+#ifdef BLOCK_CACHE
+  const Block* b = m->running;
+  if (b == NULL)
+  {
+    return cycles;
+  }
+  WORD pc = b->start;
+  for (int i = 0; i < b->count; i++)
+  {
+    pc += b->insn[i].length;
+    if (pc == m->cpu.PC)
+    {
+      while (++i < b->count)
+      {
+        cycles -= base_cycles[b->insn[i].op_code];
+      }
+      break;
+    }
+  }
+#endif
+  return cycles;
+}
+
+void machine_cancel_all(Machine* m)
+{
+  m->event_count = 0;
+  m->irq = 0;
+  m->nmi = 0;
+}
+
+// Calls the events that are due, then takes an NMI, or an IRQ while I is
+// clear. Returns nonzero when that moved PC.
+static int service(Machine* m)
+{
+  WORD pc = m->cpu.PC;
+  while (m->event_count != 0 && m->events[0].cycle <= m->cycles)
+  {
+    Event e = m->events[0];
+    remove_event(m, 0);
+    e.handler(e.context);
+  }
+  if (m->nmi)
+  {
+    m->nmi = 0;
+    cpu_interrupt(m, VECTOR_NMI);
+  }
+  else if (m->irq != 0 && !m->cpu.P.I)
+  {
+    cpu_interrupt(m, VECTOR_IRQ);
+  }
+  return m->cpu.PC != pc;
+}
+
+// execute() from one event to the next, with the events called and interrupts
+// taken in between. A journaled machine goes one instruction at a time, so
+// the journal gets the state between them; an interrupt counts as part of the
+// instruction before it.
+static StopReason run(Machine* m, unsigned long budget, unsigned long long end)
+{
+  m->watch_hit = 0;
+  for (unsigned long done = 0;;)
+  {
+    if (done == budget || m->cycles >= end)
+    {
+      return STOP_BUDGET;
+    }
+    // Breakpoints where a previous piece stopped or an interrupt went count,
+    // only the one the run started on is stepped over.
+    int moved = service(m);
+    if (m->watch_hit)
+    {
+      return STOP_WATCHPOINT;
+    }
+    if ((done != 0 || moved) && BREAKPOINT_AT(m, m->cpu.PC))
+    {
+      return STOP_BREAKPOINT;
+    }
+    m->deadline = end;
+    if (m->event_count != 0 && m->events[0].cycle < end)
+    {
+      m->deadline = m->events[0].cycle;
+    }
+    unsigned long long before = m->instructions;
+    StopReason reason;
+#ifdef JOURNAL
+    if (m->journal != NULL)
+    {
+      journal_record(m->journal, m);
+      reason = execute(m, 1);
+      if (m->instructions == before)
+      {
+        journal_forget(m->journal);
+      }
+    }
+    else
+#endif
+    {
+      reason = execute(m, budget - done);
+    }
+#ifdef BLOCK_CACHE
+    m->running = NULL;
+#endif
+    done += m->instructions - before;
+    if (reason != STOP_BUDGET)
+    {
+      return reason;
+    }
+  }
+}
+
+StopReason cpu_run(Machine* m, unsigned long budget)
+{
+  return run(m, budget, ULLONG_MAX);
+}
+
+StopReason cpu_run_cycles(Machine* m, unsigned long long cycles)
+{
+  return run(m, ULONG_MAX, m->cycles + cycles);
+}
+
+void cpu_set_breakpoint(Machine* m, WORD address)
+{
+  m->breakpoints[address >> 3] |= 1 << (address & 7);
+  // Blocks running across the address have to be split there.
+  invalidate_code_page(m, address >> 8);
+}
+
+void cpu_clear_breakpoint(Machine* m, WORD address)
+{
+  m->breakpoints[address >> 3] &= ~(1 << (address & 7));
+  invalidate_code_page(m, address >> 8);
+}
+
+void cpu_set_watchpoint(Machine* m, WORD address, int kinds)
+{
+  if (kinds & WATCH_READ)
+  {
+    m->watch_read[address >> 3] |= 1 << (address & 7);
+  }
+  if (kinds & WATCH_WRITE)
+  {
+    m->watch_write[address >> 3] |= 1 << (address & 7);
+  }
+  m->watch_page[address >> 8] |= kinds;
+  update_fast_path(m, address >> 8);
+}
+
+void cpu_clear_watchpoint(Machine* m, WORD address, int kinds)
+{
+  BYTE page = address >> 8;
+  if (kinds & WATCH_READ)
+  {
+    m->watch_read[address >> 3] &= ~(1 << (address & 7));
+  }
+  if (kinds & WATCH_WRITE)
+  {
+    m->watch_write[address >> 3] &= ~(1 << (address & 7));
+  }
+  // The page goes back on the fast path once nothing in it is watched.
+  BYTE watch = 0;
+  for (int i = page * 32; i < page * 32 + 32; i++)
+  {
+    watch |= (m->watch_read[i] ? WATCH_READ : 0) | (m->watch_write[i] ? WATCH_WRITE : 0);
+  }
+  m->watch_page[page] = watch;
+  update_fast_path(m, page);
+}
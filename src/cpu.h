@@ -0,0 +1,362 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CPU_H
+#define CPU_H
+
+#include <stddef.h>
+
+#include "opcodes.h"
+
+// 8bit;
+typedef unsigned char BYTE;
+// 16bit;
+typedef unsigned short WORD;
+typedef char SBYTE;
+typedef short SWORD;
+// Not a good idea but why not
+typedef struct
+{
+  unsigned N : 1;
+  unsigned V : 1;
+  unsigned U : 1;
+  unsigned B : 1;
+  unsigned D : 1;
+  unsigned I : 1;
+  unsigned Z : 1;
+  unsigned C : 1;
+} Status;
+typedef struct
+{
+  BYTE A;
+  BYTE X;
+  BYTE Y;
+  WORD PC;
+  BYTE S;
+  Status P;
+#ifdef LAZY_FLAGS
+  // N, Z, C and V live here instead of in P until somebody asks for them.
+  // N is bit 7 of n_result, Z is z_result == 0, C is bit 8 of c_result
+  // and V is bit 7 of v_result.
+  BYTE n_result;
+  BYTE z_result;
+  WORD c_result;
+  BYTE v_result;
+#endif
+} CPU;
+
+// Opcode constants such as LDA_IMMEDIATE, see opcodes.h.
+#define OPCODE_CONSTANT(name, code, ...) name = code,
+#define OPCODE_UNUSED(code)
+enum
+{
+  OPCODE_TABLE(OPCODE_CONSTANT, OPCODE_UNUSED)
+};
+#undef OPCODE_CONSTANT
+#undef OPCODE_UNUSED
+
+// Why cpu_run() gave control back.
+typedef enum
+{
+  // The instruction budget is used up.
+  STOP_BUDGET,
+  // PC reached a breakpoint, the instruction there has not run yet.
+  STOP_BREAKPOINT,
+  // The last instruction accessed a watched address, see Machine.watch_hit.
+  STOP_WATCHPOINT,
+  // PC is left on the BRK.
+  STOP_BRK,
+  // PC is left on the unknown opcode.
+  STOP_ILLEGAL,
+} StopReason;
+
+// Instruction size in bytes, unknown opcodes count as 1.
+extern const BYTE instruction_length[256];
+
+// Predecoded instructions, one slot per address. length == 0 means empty.
+typedef struct
+{
+  WORD operand;
+  BYTE op_code;
+  BYTE length;
+} Decoded;
+
+#ifdef BLOCK_CACHE
+// Straight-line run of predecoded instructions, translated once per entry PC
+// and executed without going back to the decode cache. Blocks end at anything
+// that can move PC somewhere else.
+#define BLOCK_MAX_INSNS 32
+#define BLOCK_CACHE_SIZE 4096
+typedef struct
+{
+  WORD start;
+  // Address of the last byte, the block may run into the next page.
+  WORD end;
+  WORD gen[2];
+  // Base cycles of all instructions, and that plus every penalty they could take.
+  WORD cycles;
+  WORD max_cycles;
+  BYTE count;
+  Decoded insn[BLOCK_MAX_INSNS];
+} Block;
+#endif
+
+// What a watchpoint watches, either or both.
+enum
+{
+  WATCH_READ = 1,
+  WATCH_WRITE = 2,
+};
+
+// Where the 6502 finds its handlers.
+enum
+{
+  VECTOR_NMI = 0xFFFA,
+  VECTOR_RESET = 0xFFFC,
+  VECTOR_IRQ = 0xFFFE,
+};
+
+// Something scheduled to happen at a given cycle, see machine_schedule().
+typedef void (*EventHandler)(void* context);
+#define MAX_EVENTS 32
+typedef struct
+{
+  unsigned long long cycle;
+  EventHandler handler;
+  void* context;
+} Event;
+
+// Whether address is set in a one-bit-per-address bitmap such as breakpoints.
+#define ADDRESS_BIT(bits, address) ((bits)[(address) >> 3] & (1 << ((address) & 7)))
+
+// Callbacks behind a memory-mapped I/O page. address is the full bus address.
+typedef BYTE (*IoRead)(void* context, WORD address);
+typedef void (*IoWrite)(void* context, WORD address, BYTE value);
+
+enum
+{
+  PAGE_RAM,
+  // Reads like RAM, writes are ignored.
+  PAGE_ROM,
+  PAGE_IO,
+};
+
+// One emulated computer: the CPU and everything it can see. Machines share
+// nothing, so each one can run on its own thread.
+typedef struct
+{
+  CPU cpu;
+  // Memory for 6502 (64KB)
+  BYTE memory[1 * 64 * 1024];
+  // Cycles executed so far. Blocks are charged up front, so inside one this
+  // may already include instructions that have not run yet.
+  unsigned long long cycles;
+  // Instructions executed so far, brought up to date whenever cpu_run() returns.
+  unsigned long long instructions;
+  // Set to run BRK as the software interrupt through $FFFE instead of
+  // stopping with STOP_BRK.
+  BYTE brk_interrupt;
+  // The last access to a watched address: WATCH_READ or WATCH_WRITE, 0 if
+  // none since cpu_run() started.
+  BYTE watch_hit;
+  WORD watch_address;
+
+  // Everything below belongs to the core.
+  // Page table. read_page/write_page are what mem_read/mem_write index
+  // directly; NULL sends the access down the slow path, which is where I/O,
+  // ROM writes and writes into cached code end up.
+  BYTE* read_page[256];
+  BYTE* write_page[256];
+  // Where RAM and ROM pages really live, even while the fast path is off.
+  BYTE* host_page[256];
+  BYTE page_type[256];
+  IoRead io_read[256];
+  IoWrite io_write[256];
+  void* io_context[256];
+  // One bit per address, see ADDRESS_BIT().
+  BYTE breakpoints[1 * 64 * 1024 / 8];
+  BYTE watch_read[1 * 64 * 1024 / 8];
+  BYTE watch_write[1 * 64 * 1024 / 8];
+  // The kinds of watchpoint set in each page. Their accesses take the slow
+  // path, everything else never looks at the bitmaps.
+  BYTE watch_page[256];
+  Decoded decode_cache[1 * 64 * 1024];
+  // Set for every page that holds bytes of a cached instruction.
+  BYTE code_page[256];
+  // Bumped whenever a code page gets invalidated, translated blocks check it.
+  WORD page_gen[256];
+  // Set when the code under the running block may have changed.
+  BYTE code_dirty;
+  // Where the run gives control back: the end of its cycle budget or the next
+  // event, whichever comes first. 0 stops it after the current instruction.
+  unsigned long long deadline;
+  // Pending events, a binary min-heap on cycle.
+  Event events[MAX_EVENTS];
+  int event_count;
+  // The IRQ sources holding the line, a bit each, and an NMI not taken yet.
+  unsigned irq;
+  BYTE nmi;
+  // Gets every interrupt taken while set, see replay.h.
+  struct Recording* recording;
+  // Decoded instructions that must not be cached, i.e. ones fetched from I/O.
+  Decoded uncached;
+  // Set for RAM pages not written since memory was last in sync with the
+  // snapshot called baseline; their writes are trapped so the first one can go
+  // on dirty_list. All zero while there is no baseline.
+  BYTE clean_page[256];
+  BYTE dirty_list[256];
+  int dirty_count;
+  unsigned long baseline;
+#ifdef BLOCK_CACHE
+  Block block_cache[BLOCK_CACHE_SIZE];
+  // The block charged in one go that is running, NULL between blocks or when
+  // running single instructions. See machine_now().
+  const Block* running;
+#endif
+#ifdef IDLE_SKIP
+  // Device reads so far, and where the last jump backwards went with the
+  // state at the time, see skip_idle_loop().
+  unsigned long io_reads;
+  unsigned idle_countdown;
+  BYTE idle_armed;
+  WORD idle_pc;
+  CPU idle_cpu;
+  unsigned long long idle_cycles;
+  unsigned long long idle_instructions;
+  unsigned long idle_io_reads;
+#endif
+#ifdef TRACE
+  // Gets every instruction while set, see trace.h.
+  struct Trace* trace;
+#endif
+#ifdef PROFILE
+  // Counts every instruction while set, see profile.h.
+  struct Profile* profile;
+#endif
+#ifdef COVERAGE
+  // Every conditional branch counts its edge here while set, see fuzz.h.
+  struct Coverage* coverage;
+#endif
+#ifdef JOURNAL
+  // Gets every instruction and RAM write while set, see journal.h.
+  struct Journal* journal;
+#endif
+} Machine;
+
+// Saved CPU and memory contents of a machine.
+typedef struct
+{
+  // Unique across all snapshots, 0 is never used.
+  unsigned long id;
+  CPU cpu;
+  unsigned long long cycles;
+  unsigned long long instructions;
+  BYTE memory[1 * 64 * 1024];
+} Snapshot;
+
+// Returns a zeroed machine with all 64KB mapped as RAM, or NULL when out of
+// memory.
+Machine* machine_create(void);
+void machine_destroy(Machine* m);
+// The map functions work on whole pages: every page touched by start..end
+// gets the new mapping.
+void machine_map_ram(Machine* m, WORD start, WORD end);
+// image holds the bytes for those whole pages and has to outlive the mapping.
+// NULL uses the machine's own memory array, so it can be filled beforehand.
+void machine_map_rom(Machine* m, WORD start, WORD end, const BYTE* image);
+void machine_map_io(Machine* m, WORD start, WORD end, IoRead read, IoWrite write,
+                    void* context);
+#ifdef JOURNAL
+// Sets m->journal, NULL stops journaling. Every RAM write takes the slow path
+// while a journal is set.
+void machine_set_journal(Machine* m, struct Journal* j);
+#endif
+// Saves m and makes the snapshot its baseline, NULL when out of memory. The page
+// table, breakpoints, devices and pending events are not part of it.
+Snapshot* snapshot_create(Machine* m);
+// Puts m back into the state s was taken in. Restoring the baseline only copies
+// the pages written since, anything else copies all 64KB once and becomes the
+// new baseline. Restoring into another machine forks it. Writes straight into
+// memory[] are not tracked, set m->baseline to 0 to force a full copy.
+void snapshot_restore(Machine* m, const Snapshot* s);
+void snapshot_destroy(Snapshot* s);
+BYTE mem_read(Machine* m, WORD address);
+void mem_write(Machine* m, WORD address, BYTE value);
+// Reads without side effects for debuggers and tools: devices are not asked,
+// their pages read as 0xFF like an unmapped bus.
+BYTE mem_peek(const Machine* m, WORD address);
+// Copies data into memory[] at address and drops whatever was decoded from
+// there. Page types are ignored, so it can fill ROM pages backed by memory[]
+// too. size must not run past 0xFFFF.
+void mem_load(Machine* m, WORD address, const BYTE* data, size_t size);
+// What the RESET line does: loads PC from VECTOR_RESET, sets I and drops a
+// pending NMI. Devices, their events and the IRQ line are left alone.
+void cpu_reset(Machine* m);
+// Points the reset vector at start, then resets, so later resets go there too.
+// A ROM page used in place keeps its own vector; PC still starts at start.
+void cpu_reset_to(Machine* m, WORD start);
+Status cpu_status(const CPU* cpu);
+// The same as the byte PHP would push, NV-BDIZC from bit 7 down.
+BYTE cpu_status_byte(const CPU* cpu);
+// Loads P the way PLP does.
+void cpu_set_status_byte(CPU* cpu, BYTE value);
+// ADC and SBC of value into A, decimal mode included.
+void cpu_adc(CPU* cpu, BYTE value);
+void cpu_sbc(CPU* cpu, BYTE value);
+// Runs until budget instructions have executed or something stops it first.
+// A breakpoint on the very first instruction is ignored so a stopped run can
+// be resumed.
+StopReason cpu_run(Machine* m, unsigned long budget);
+// Same, but the budget is in cycles: stops at the first instruction boundary
+// at or past m->cycles + cycles, so the overshoot is less than one instruction.
+StopReason cpu_run_cycles(Machine* m, unsigned long long cycles);
+void cpu_set_breakpoint(Machine* m, WORD address);
+void cpu_clear_breakpoint(Machine* m, WORD address);
+// kinds is WATCH_READ, WATCH_WRITE or both. Accessing a watched address stops
+// the run with STOP_WATCHPOINT once the instruction doing it is done.
+// Instruction fetches are not reads.
+void cpu_set_watchpoint(Machine* m, WORD address, int kinds);
+void cpu_clear_watchpoint(Machine* m, WORD address, int kinds);
+
+// Interrupt lines. Every IRQ source owns a bit of m->irq and holds the line
+// (asserted != 0) until it lets go; the IRQ is taken between instructions
+// whenever the line is held and I is clear. cpu_nmi() is an edge, taken once
+// after the current instruction whatever I says.
+void cpu_set_irq(Machine* m, unsigned sources, int asserted);
+void cpu_nmi(Machine* m);
+// Takes the interrupt through vector now: pushes PC and P (B clear), sets I
+// and costs 7 cycles. For event handlers that need exact control; devices
+// should go through the lines above.
+void cpu_interrupt(Machine* m, WORD vector);
+
+// Event scheduler. handler(context) is called between two instructions once
+// m->cycles reaches cycle; events for the same cycle come in no particular
+// order. A run only stops at the next pending event, nothing gets polled
+// after every instruction. Events may schedule more and change the interrupt
+// lines. Returns 0, or -1 when MAX_EVENTS are already pending.
+int machine_schedule(Machine* m, unsigned long long cycle, EventHandler handler, void* context);
+// Drops every pending event with this handler and context.
+void machine_cancel(Machine* m, EventHandler handler, void* context);
+// The cycle the instruction running now ends on, m->cycles outside of runs.
+// Devices use it to time accesses, since inside a block m->cycles already
+// counts the instructions after the current one.
+unsigned long long machine_now(const Machine* m);
+// Drops all pending events and lets go of both interrupt lines, for when the
+// devices behind them get replaced.
+void machine_cancel_all(Machine* m);
+
+#endif
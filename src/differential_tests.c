@@ -0,0 +1,246 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// differential_tests: runs random programs three ways and checks that they end
+// up in the same state: the lockstep engine with all 16 lanes at once, each
+// lane on its own Machine with one cpu_run() over the whole budget, and again
+// one instruction per cpu_run(). The last never has a block to finish or an
+// idle loop to skip, so together they catch BLOCK_CACHE, LAZY_FLAGS and
+// IDLE_SKIP drifting from plain stepping, and the lanes drifting from both.
+//
+// Memory is filled with official opcodes other than BRK, the same for every
+// lane. Each lane gets its own zero page and registers, so lanes branch apart
+// and meet again. Every fourth program starts with LDA $10 / BEQ *-2, which
+// idles on the lanes whose $10 is zero.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cpu.h"
+#include "disasm.h"
+#include "lockstep.h"
+
+static unsigned long long seed = 88172645463325252ULL;
+static unsigned long printed;
+
+static unsigned random_number(void)
+{
+  seed ^= seed << 13;
+  seed ^= seed >> 7;
+  seed ^= seed << 17;
+  return (unsigned)seed;
+}
+
+// What a lane starts with besides the code.
+typedef struct
+{
+  BYTE zero_page[256];
+  BYTE a, x, y, s, p;
+} Start;
+
+static void start_machine(Machine* m, const BYTE* code, WORD entry, const Start* s)
+{
+  mem_load(m, 0, code, 0x10000);
+  mem_load(m, 0, s->zero_page, sizeof s->zero_page);
+  CPU* cpu = &m->cpu;
+  cpu->A = s->a;
+  cpu->X = s->x;
+  cpu->Y = s->y;
+  cpu->S = s->s;
+  cpu->PC = entry;
+  cpu_set_status_byte(cpu, s->p);
+  m->cycles = 0;
+  m->instructions = 0;
+}
+
+// Prints the first difference between a and b. Returns 0 if there is none.
+static int compare(const char* what, unsigned long program, int lane, const Machine* a,
+                   StopReason a_reason, const Machine* b, StopReason b_reason)
+{
+  const CPU* x = &a->cpu;
+  const CPU* y = &b->cpu;
+  char difference[80] = "";
+  if (a_reason != b_reason)
+  {
+    snprintf(difference, sizeof difference, "stop %d vs %d", a_reason, b_reason);
+  }
+  else if (x->A != y->A || x->X != y->X || x->Y != y->Y || x->S != y->S || x->PC != y->PC ||
+           cpu_status_byte(x) != cpu_status_byte(y))
+  {
+    snprintf(difference, sizeof difference,
+             "A=%02X X=%02X Y=%02X S=%02X P=%02X PC=%04X vs A=%02X X=%02X Y=%02X S=%02X P=%02X "
+             "PC=%04X",
+             x->A, x->X, x->Y, x->S, cpu_status_byte(x), x->PC, y->A, y->X, y->Y, y->S,
+             cpu_status_byte(y), y->PC);
+  }
+  else if (a->cycles != b->cycles || a->instructions != b->instructions)
+  {
+    snprintf(difference, sizeof difference, "%llu cycles, %llu instructions vs %llu, %llu",
+             a->cycles, a->instructions, b->cycles, b->instructions);
+  }
+  else if (memcmp(a->memory, b->memory, sizeof a->memory) != 0)
+  {
+    for (int i = 0; i < 0x10000; i++)
+    {
+      if (a->memory[i] != b->memory[i])
+      {
+        snprintf(difference, sizeof difference, "$%04X=%02X vs %02X", i, a->memory[i],
+                 b->memory[i]);
+        break;
+      }
+    }
+  }
+  if (difference[0] == '\0')
+  {
+    return 0;
+  }
+  if (printed++ < 20)
+  {
+    printf("program %lu lane %d, %s: %s\n", program, lane, what, difference);
+  }
+  return 1;
+}
+
+static void usage(const char* name)
+{
+  fprintf(stderr, "usage: %s [-n programs] [-i instructions] [-s seed]\n", name);
+}
+
+int main(int argc, char** argv)
+{
+  unsigned long programs = 1000;
+  unsigned long budget = 1000;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:i:s:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'n':
+      programs = strtoul(optarg, NULL, 0);
+      break;
+    case 'i':
+      budget = strtoul(optarg, NULL, 0);
+      break;
+    case 's':
+      seed = strtoull(optarg, NULL, 0) | 1;
+      break;
+    default:
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (optind != argc)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  BYTE opcodes[256];
+  int opcode_count = 0;
+  for (int op = 1; op < 256; op++)
+  {
+    if (strcmp(opcode_name[op], "???") != 0)
+    {
+      opcodes[opcode_count++] = op;
+    }
+  }
+  static BYTE code[0x10000];
+  Start starts[LOCKSTEP_LANES];
+  Lockstep* g = lockstep_create();
+  Machine* run = machine_create();
+  Machine* step = machine_create();
+  Machine* lane = machine_create();
+  if (g == NULL || run == NULL || step == NULL || lane == NULL)
+  {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  unsigned long failures = 0;
+  for (unsigned long program = 0; program < programs; program++)
+  {
+    for (int i = 0; i < 0x10000; i++)
+    {
+      code[i] = opcodes[random_number() % opcode_count];
+    }
+    WORD entry = random_number();
+    int idle = program % 4 == 0 && entry <= 0xFFFC;
+    if (idle)
+    {
+      memcpy(&code[entry], (const BYTE[]){0xA5, 0x10, 0xF0, 0xFC}, 4);
+    }
+    lockstep_reset(g);
+    lockstep_load(g, -1, 0, code, sizeof code);
+    for (int l = 0; l < LOCKSTEP_LANES; l++)
+    {
+      Start* s = &starts[l];
+      for (int i = 0; i < 256; i++)
+      {
+        s->zero_page[i] = random_number();
+      }
+      if (idle && l % 2 == 0)
+      {
+        s->zero_page[0x10] = 0;
+      }
+      s->a = random_number();
+      s->x = random_number();
+      s->y = random_number();
+      s->s = random_number();
+      s->p = random_number();
+      lockstep_load(g, l, 0, s->zero_page, sizeof s->zero_page);
+      g->a[l] = s->a;
+      g->x[l] = s->x;
+      g->y[l] = s->y;
+      g->s[l] = s->s;
+      g->pc[l] = entry;
+      g->n_result[l] = s->p & 0x80;
+      g->z_result[l] = !(s->p & 0x02);
+      g->c[l] = s->p & 0x01;
+      g->v[l] = s->p >> 6 & 1;
+      g->d[l] = s->p >> 3 & 1;
+      g->i[l] = s->p >> 2 & 1;
+      g->cycles[l] = 0;
+      g->instructions[l] = 0;
+    }
+    lockstep_run(g, LOCKSTEP_LANES, budget);
+
+    for (int l = 0; l < LOCKSTEP_LANES; l++)
+    {
+      start_machine(run, code, entry, &starts[l]);
+      start_machine(step, code, entry, &starts[l]);
+      StopReason run_reason = cpu_run(run, budget);
+      StopReason step_reason = STOP_BUDGET;
+      for (unsigned long i = 0; i < budget && step_reason == STOP_BUDGET; i++)
+      {
+        step_reason = cpu_run(step, 1);
+      }
+      lockstep_get(g, l, lane);
+      int failed = compare("cpu_run() vs stepping", program, l, run, run_reason, step, step_reason);
+      failed |= compare("cpu_run() vs lockstep", program, l, run, run_reason, lane, g->reason[l]);
+      failures += failed;
+    }
+  }
+  printf("%lu programs of %lu instructions on %d lanes, %lu lanes failed\n", programs, budget,
+         LOCKSTEP_LANES, failures);
+  lockstep_destroy(g);
+  machine_destroy(run);
+  machine_destroy(step);
+  machine_destroy(lane);
+  return failures != 0;
+}
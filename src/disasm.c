@@ -0,0 +1,76 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "disasm.h"
+
+#include <stdio.h>
+
+#define NAME(name, code, ...) [code] = #name,
+#define MNEMONIC(name, code, mnemonic, ...) [code] = #mnemonic,
+#define MODE(name, code, mnemonic, mode, ...) [code] = MODE_##mode,
+#define FLAGS(name, code, mnemonic, mode, bytes, cycles, penalty, flags) [code] = flags,
+#define UNKNOWN_NAME(code) [code] = "???",
+#define UNKNOWN_MNEMONIC(code) [code] = "???",
+#define UNKNOWN_MODE(code) [code] = MODE_IMPLIED,
+#define UNKNOWN_FLAGS(code) [code] = "-",
+const char* const opcode_name[256] = {OPCODE_TABLE(NAME, UNKNOWN_NAME)};
+const char* const mnemonic[256] = {OPCODE_TABLE(MNEMONIC, UNKNOWN_MNEMONIC)};
+const BYTE addressing_mode[256] = {OPCODE_TABLE(MODE, UNKNOWN_MODE)};
+const char* const flags_affected[256] = {OPCODE_TABLE(FLAGS, UNKNOWN_FLAGS)};
+#undef NAME
+#undef MNEMONIC
+#undef MODE
+#undef FLAGS
+#undef UNKNOWN_NAME
+#undef UNKNOWN_MNEMONIC
+#undef UNKNOWN_MODE
+#undef UNKNOWN_FLAGS
+
+int disasm(char* buf, size_t size, WORD pc, BYTE op_code, WORD operand)
+{
+  const char* name = mnemonic[op_code];
+  switch (addressing_mode[op_code])
+  {
+  case MODE_ACCUMULATOR:
+    return snprintf(buf, size, "%s A", name);
+  case MODE_IMMEDIATE:
+    return snprintf(buf, size, "%s #$%02X", name, operand);
+  case MODE_ZEROPAGE:
+    return snprintf(buf, size, "%s $%02X", name, operand);
+  case MODE_ZEROPAGE_X:
+    return snprintf(buf, size, "%s $%02X,X", name, operand);
+  case MODE_ZEROPAGE_Y:
+    return snprintf(buf, size, "%s $%02X,Y", name, operand);
+  case MODE_ABSOLUTE:
+    return snprintf(buf, size, "%s $%04X", name, operand);
+  case MODE_ABSOLUTE_X:
+    return snprintf(buf, size, "%s $%04X,X", name, operand);
+  case MODE_ABSOLUTE_Y:
+    return snprintf(buf, size, "%s $%04X,Y", name, operand);
+  case MODE_INDIRECT:
+    return snprintf(buf, size, "%s ($%04X)", name, operand);
+  case MODE_INDIRECT_X:
+    return snprintf(buf, size, "%s ($%02X,X)", name, operand);
+  case MODE_INDIRECT_Y:
+    return snprintf(buf, size, "%s ($%02X),Y", name, operand);
+  case MODE_RELATIVE:
+    // Shown as the target, like an assembler would take it.
+    return snprintf(buf, size, "%s $%04X", name, (WORD)(pc + 2 + (signed char)operand));
+  default:
+    return snprintf(buf, size, "%s", name);
+  }
+}
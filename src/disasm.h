@@ -0,0 +1,54 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DISASM_H
+#define DISASM_H
+
+#include <stddef.h>
+
+#include "cpu.h"
+
+enum
+{
+  MODE_IMPLIED,
+  MODE_ACCUMULATOR,
+  MODE_IMMEDIATE,
+  MODE_ZEROPAGE,
+  MODE_ZEROPAGE_X,
+  MODE_ZEROPAGE_Y,
+  MODE_ABSOLUTE,
+  MODE_ABSOLUTE_X,
+  MODE_ABSOLUTE_Y,
+  MODE_INDIRECT,
+  MODE_INDIRECT_X,
+  MODE_INDIRECT_Y,
+  MODE_RELATIVE,
+};
+
+// Official NMOS opcodes only, everything else is "???" and MODE_IMPLIED.
+// opcode_name is the constant from cpu.h, e.g. "LDA_IMMEDIATE".
+extern const char* const opcode_name[256];
+extern const char* const mnemonic[256];
+extern const BYTE addressing_mode[256];
+// The flags each opcode can change, e.g. "NZC", or "-" for none.
+extern const char* const flags_affected[256];
+
+// Writes one instruction as assembly, e.g. "LDA $10F0,X", and returns what
+// snprintf returns. pc is the address of the instruction itself.
+int disasm(char* buf, size_t size, WORD pc, BYTE op_code, WORD operand);
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fuzz.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+Fuzzer* fuzz_create(Machine* m, WORD window, size_t window_size, unsigned long budget)
+{
+  Fuzzer* f = calloc(1, sizeof *f);
+  if (f == NULL)
+  {
+    return NULL;
+  }
+  f->start = snapshot_create(m);
+  if (f->start == NULL)
+  {
+    free(f);
+    return NULL;
+  }
+  f->machine = m;
+  f->window = window;
+  size_t room = 0x10000 - window;
+  f->window_size = window_size < room ? window_size : room;
+  f->budget = budget;
+  m->coverage = &f->coverage;
+  return f;
+}
+
+void fuzz_destroy(Fuzzer* f)
+{
+  if (f == NULL)
+  {
+    return;
+  }
+  if (f->machine->coverage == &f->coverage)
+  {
+    f->machine->coverage = NULL;
+  }
+  snapshot_destroy(f->start);
+  free(f);
+}
+
+StopReason fuzz_run(Fuzzer* f, const BYTE* data, size_t size)
+{
+  Machine* m = f->machine;
+  // The start snapshot is the machine's baseline, so this only copies back
+  // what the last run wrote, the window included.
+  snapshot_restore(m, f->start);
+  // Events and interrupts are not in the snapshot, none may leak into the next run.
+  machine_cancel_all(m);
+  mem_load(m, f->window, data, size < f->window_size ? size : f->window_size);
+  Coverage* c = &f->coverage;
+  for (unsigned i = 0; i < c->hit_count; i++)
+  {
+    c->map[c->hit[i]] = 0;
+  }
+  c->hit_count = 0;
+  return cpu_run(m, f->budget);
+}
+
+// AFL's hit count classes, one bit each.
+static BYTE bucket(BYTE count)
+{
+  if (count <= 3)
+  {
+    return count == 3 ? 4 : count;
+  }
+  if (count <= 7)
+  {
+    return 8;
+  }
+  if (count <= 15)
+  {
+    return 16;
+  }
+  if (count <= 31)
+  {
+    return 32;
+  }
+  return count <= 127 ? 64 : 128;
+}
+
+int fuzz_new_coverage(const Fuzzer* f, BYTE* seen)
+{
+  const Coverage* c = &f->coverage;
+  int found = 0;
+  for (unsigned i = 0; i < c->hit_count; i++)
+  {
+    WORD edge = c->hit[i];
+    BYTE b = bucket(c->map[edge]);
+    if (b & ~seen[edge])
+    {
+      seen[edge] |= b;
+      found = 1;
+    }
+  }
+  return found;
+}
@@ -0,0 +1,71 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FUZZ_H
+#define FUZZ_H
+
+#include <stddef.h>
+
+#include "cpu.h"
+
+// In-process fuzzing. A Fuzzer remembers a machine with its program set up,
+// then runs it once per input: the machine goes back to that state (only the
+// pages the last run wrote get copied), the input lands in a RAM window and
+// the program runs under an instruction budget while every conditional
+// branch counts its edge in coverage. Pending events and interrupts are
+// dropped before each run; devices keep their state, so the machine should
+// have none. Needs COVERAGE.
+
+#define FUZZ_MAP_SIZE (1 * 64 * 1024)
+
+// AFL style edge counters. Counters skip 0 when they wrap, so each one goes on
+// the hit list once, and clearing or scanning the map only has to look at the
+// edges the run took.
+typedef struct Coverage
+{
+  BYTE map[FUZZ_MAP_SIZE];
+  WORD hit[FUZZ_MAP_SIZE];
+  unsigned hit_count;
+} Coverage;
+
+typedef struct
+{
+  Machine* machine;
+  // What every run starts from.
+  Snapshot* start;
+  WORD window;
+  size_t window_size;
+  unsigned long budget;
+  // Edges of the last run.
+  Coverage coverage;
+} Fuzzer;
+
+// Takes m as it is now as the start of every run. Inputs go to window and are
+// cut to window_size bytes, which is itself cut to end at $FFFF. Returns NULL
+// when out of memory.
+Fuzzer* fuzz_create(Machine* m, WORD window, size_t window_size, unsigned long budget);
+// Detaches the coverage map from the machine, which is left as is.
+void fuzz_destroy(Fuzzer* f);
+// Runs the program once over data. Bytes of the window past size keep their
+// starting values.
+StopReason fuzz_run(Fuzzer* f, const BYTE* data, size_t size);
+// Compares the last run's coverage against seen, with counts put into AFL's
+// buckets (1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+). Returns 1 and adds them
+// to seen if anything is new. seen holds FUZZ_MAP_SIZE bytes, zeroed to begin.
+int fuzz_new_coverage(const Fuzzer* f, BYTE* seen);
+
+#endif
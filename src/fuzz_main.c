@@ -0,0 +1,341 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// emulator_fuzz: coverage-guided fuzzing of a guest program. Inputs are
+// mutated AFL style, the ones reaching new branch edges join the corpus, and
+// inputs that run into an unknown opcode are counted as crashes.
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cpu.h"
+#include "fuzz.h"
+#include "loader.h"
+#include "memmap.h"
+
+static void usage(const char* name)
+{
+  fprintf(stderr,
+          "usage: %s [-m memory.map] [-a load-address] [-r reset-address] [-w window-address] "
+          "[-z window-size] [-n budget] [-t seconds] [-o crash-dir] image [seed...]\n",
+          name);
+}
+
+static int parse_address(const char* text, WORD* address)
+{
+  char* end;
+  unsigned long value = strtoul(text, &end, 16);
+  if (*text == '\0' || *end != '\0' || value > 0xFFFF)
+  {
+    fprintf(stderr, "'%s' is not a hex address\n", text);
+    return -1;
+  }
+  *address = value;
+  return 0;
+}
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long long seed = 88172645463325252ULL;
+
+// xorshift64*. Plain xorshift's low bits are too linear: some position and
+// value pairs would never come up together.
+static unsigned random_below(unsigned n)
+{
+  seed ^= seed >> 12;
+  seed ^= seed << 25;
+  seed ^= seed >> 27;
+  return (seed * 0x2545F4914F6CDD1DULL >> 32) % n;
+}
+
+// A few havoc rounds: flipped bits, random and boundary bytes, small sums.
+static void mutate(BYTE* data, size_t size)
+{
+  static const BYTE interesting[] = {0x00, 0x01, 0x7F, 0x80, 0xFF};
+  for (unsigned rounds = 1 + random_below(8); rounds > 0; rounds--)
+  {
+    BYTE* at = data + random_below(size);
+    switch (random_below(4))
+    {
+    case 0:
+      *at ^= 1 << random_below(8);
+      break;
+    case 1:
+      *at = random_below(256);
+      break;
+    case 2:
+      *at = interesting[random_below(sizeof interesting)];
+      break;
+    default:
+      *at += random_below(35) - 17;
+      break;
+    }
+  }
+}
+
+typedef struct
+{
+  BYTE** inputs;
+  size_t count;
+  size_t capacity;
+  size_t size;
+} Corpus;
+
+static int corpus_add(Corpus* c, const BYTE* data)
+{
+  if (c->count == c->capacity)
+  {
+    size_t capacity = c->capacity ? c->capacity * 2 : 64;
+    BYTE** inputs = realloc(c->inputs, capacity * sizeof *inputs);
+    if (inputs == NULL)
+    {
+      return -1;
+    }
+    c->inputs = inputs;
+    c->capacity = capacity;
+  }
+  BYTE* copy = malloc(c->size);
+  if (copy == NULL)
+  {
+    return -1;
+  }
+  memcpy(copy, data, c->size);
+  c->inputs[c->count++] = copy;
+  return 0;
+}
+
+static void corpus_free(Corpus* c)
+{
+  for (size_t i = 0; i < c->count; i++)
+  {
+    free(c->inputs[i]);
+  }
+  free(c->inputs);
+}
+
+// Reads up to size bytes of path into data, the rest stays zero.
+static int read_seed(const char* path, BYTE* data, size_t size)
+{
+  FILE* file = fopen(path, "rb");
+  if (file == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+  memset(data, 0, size);
+  // Short seeds are fine, only a read error is not.
+  int failed = fread(data, 1, size, file) < size && ferror(file);
+  fclose(file);
+  if (failed)
+  {
+    fprintf(stderr, "%s: read error\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+static void save_crash(const char* dir, unsigned long number, const BYTE* data, size_t size)
+{
+  char path[PATH_MAX];
+  snprintf(path, sizeof path, "%s/crash-%06lu.bin", dir, number);
+  FILE* file = fopen(path, "wb");
+  if (file == NULL || fwrite(data, 1, size, file) != size)
+  {
+    perror(path);
+  }
+  if (file != NULL)
+  {
+    fclose(file);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const char* map_path = NULL;
+  const char* crash_dir = NULL;
+  WORD load_address = 0x8000;
+  WORD start;
+  int have_start = 0;
+  WORD window = 0x0200;
+  size_t window_size = 256;
+  unsigned long budget = 100000;
+  double seconds = 10.0;
+  int opt;
+  while ((opt = getopt(argc, argv, "m:a:r:w:z:n:t:o:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'm':
+      map_path = optarg;
+      break;
+    case 'a':
+      if (parse_address(optarg, &load_address) != 0)
+      {
+        return 2;
+      }
+      break;
+    case 'r':
+      if (parse_address(optarg, &start) != 0)
+      {
+        return 2;
+      }
+      have_start = 1;
+      break;
+    case 'w':
+      if (parse_address(optarg, &window) != 0)
+      {
+        return 2;
+      }
+      break;
+    case 'z':
+      window_size = strtoul(optarg, NULL, 0);
+      break;
+    case 'n':
+      budget = strtoul(optarg, NULL, 0);
+      break;
+    case 't':
+      seconds = atof(optarg);
+      break;
+    case 'o':
+      crash_dir = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (optind >= argc || window_size == 0)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+  Machine* m = machine_create();
+  if (m == NULL)
+  {
+    return 1;
+  }
+  Image image;
+  if ((map_path != NULL && memmap_load(m, map_path) != 0) ||
+      image_load(m, argv[optind], load_address, 0, &image) != 0)
+  {
+    machine_destroy(m);
+    return 1;
+  }
+  // Device state is not part of a snapshot and would carry over between inputs.
+  for (int page = 0; page < 256; page++)
+  {
+    if (m->page_type[page] == PAGE_IO)
+    {
+      fprintf(stderr, "%s: io devices cannot be fuzzed\n", map_path);
+      machine_destroy(m);
+      return 1;
+    }
+  }
+  if (have_start)
+  {
+    cpu_reset_to(m, start);
+  }
+  else if (image.first > 0xFFFC || image.last < 0xFFFD)
+  {
+    cpu_reset_to(m, image.entry >= 0 ? image.entry : image.first);
+  }
+  else
+  {
+    cpu_reset(m);
+    if (image.entry >= 0)
+    {
+      m->cpu.PC = image.entry;
+    }
+  }
+  Fuzzer* f = fuzz_create(m, window, window_size, budget);
+  BYTE* seen = calloc(1, FUZZ_MAP_SIZE);
+  Corpus corpus = {.size = f != NULL ? f->window_size : 0};
+  BYTE* input = malloc(corpus.size);
+  if (f == NULL || seen == NULL || input == NULL)
+  {
+    fprintf(stderr, "%s: out of memory\n", argv[0]);
+    return 1;
+  }
+  // Seeds go in whether they find anything or not, an all-zero window when
+  // there are none.
+  memset(input, 0, corpus.size);
+  int seeds = argc - optind - 1;
+  for (int i = 0; i < (seeds > 0 ? seeds : 1); i++)
+  {
+    if ((seeds > 0 && read_seed(argv[optind + 1 + i], input, corpus.size) != 0) ||
+        corpus_add(&corpus, input) != 0)
+    {
+      return 1;
+    }
+    fuzz_run(f, input, corpus.size);
+    fuzz_new_coverage(f, seen);
+  }
+  unsigned long execs = 0;
+  unsigned long crashes = 0;
+  unsigned long hangs = 0;
+  double begin = now();
+  double elapsed = 0;
+  while (elapsed < seconds)
+  {
+    // Checking the clock every exec would cost more than a short run.
+    for (int i = 0; i < 256; i++)
+    {
+      memcpy(input, corpus.inputs[random_below(corpus.count)], corpus.size);
+      mutate(input, corpus.size);
+      StopReason reason = fuzz_run(f, input, corpus.size);
+      execs++;
+      if (reason == STOP_ILLEGAL)
+      {
+        if (crash_dir != NULL)
+        {
+          save_crash(crash_dir, crashes, input, corpus.size);
+        }
+        crashes++;
+      }
+      hangs += reason == STOP_BUDGET;
+      if (fuzz_new_coverage(f, seen) && corpus_add(&corpus, input) != 0)
+      {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+      }
+    }
+    elapsed = now() - begin;
+  }
+  unsigned long edges = 0;
+  for (size_t i = 0; i < FUZZ_MAP_SIZE; i++)
+  {
+    edges += seen[i] != 0;
+  }
+  printf("execs,seconds,execs_per_second,edges,corpus,crashes,hangs\n");
+  printf("%lu,%.3f,%.0f,%lu,%zu,%lu,%lu\n", execs, elapsed, execs / elapsed, edges, corpus.count,
+         crashes, hangs);
+  corpus_free(&corpus);
+  free(input);
+  free(seen);
+  fuzz_destroy(f);
+  machine_destroy(m);
+  return 0;
+}
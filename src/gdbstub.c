@@ -0,0 +1,680 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "gdbstub.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifdef JOURNAL
+#include "journal.h"
+#endif
+
+#define PACKET_SIZE 4096
+// Instructions between looks at the socket while running.
+#define RUN_SLICE 100000
+
+typedef struct
+{
+  Machine* m;
+  int fd;
+  // Acknowledgements are on until the debugger turns them off.
+  int ack;
+  BYTE input[PACKET_SIZE];
+  size_t input_used;
+  size_t input_read;
+  char packet[PACKET_SIZE + 1];
+  char reply[PACKET_SIZE + 1];
+} Session;
+
+// Appends what the debugger has sent to the unread input. Returns -1 once the
+// connection is gone.
+static int receive(Session* s)
+{
+  memmove(s->input, s->input + s->input_read, s->input_used - s->input_read);
+  s->input_used -= s->input_read;
+  s->input_read = 0;
+  ssize_t n;
+  do
+  {
+    n = recv(s->fd, s->input + s->input_used, sizeof s->input - s->input_used, 0);
+  } while (n < 0 && errno == EINTR);
+  if (n <= 0)
+  {
+    return -1;
+  }
+  s->input_used += n;
+  return 0;
+}
+
+// Next byte from the debugger, -1 once the connection is gone.
+static int get_byte(Session* s)
+{
+  if (s->input_read == s->input_used && receive(s) != 0)
+  {
+    return -1;
+  }
+  return s->input[s->input_read++];
+}
+
+static int send_all(Session* s, const char* data, size_t size)
+{
+  while (size != 0)
+  {
+    ssize_t n = send(s->fd, data, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (n <= 0)
+    {
+      return -1;
+    }
+    data += n;
+    size -= n;
+  }
+  return 0;
+}
+
+static int hex_digit(int c)
+{
+  if (c >= '0' && c <= '9')
+  {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f')
+  {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F')
+  {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// Reads a hex number at *text and moves past it. Returns the number of digits.
+static int parse_hex(const char** text, unsigned long* value)
+{
+  int digits = 0;
+  *value = 0;
+  for (int d; (d = hex_digit(**text)) >= 0; (*text)++, digits++)
+  {
+    *value = *value << 4 | d;
+  }
+  return digits;
+}
+
+// Reads the next packet into s->packet. Returns its length, or -1 once the
+// connection is gone. Interrupts while nothing runs are dropped.
+static int read_packet(Session* s)
+{
+  for (;;)
+  {
+    int c;
+    do
+    {
+      c = get_byte(s);
+      if (c < 0)
+      {
+        return -1;
+      }
+    } while (c != '$');
+    size_t size = 0;
+    BYTE sum = 0;
+    int overflow = 0;
+    while ((c = get_byte(s)) != '#')
+    {
+      if (c < 0)
+      {
+        return -1;
+      }
+      if (size == PACKET_SIZE)
+      {
+        overflow = 1;
+      }
+      else
+      {
+        s->packet[size++] = c;
+      }
+      sum += c;
+    }
+    int high = hex_digit(get_byte(s));
+    int low = hex_digit(get_byte(s));
+    int good = !overflow && high >= 0 && low >= 0 && (high << 4 | low) == sum;
+    if (s->ack && send_all(s, good ? "+" : "-", 1) != 0)
+    {
+      return -1;
+    }
+    if (good)
+    {
+      s->packet[size] = '\0';
+      return size;
+    }
+  }
+}
+
+// Sends data, which has to be plain text without '$', '#' or '}'.
+static int send_packet(Session* s, const char* data)
+{
+  char frame[PACKET_SIZE + 5];
+  BYTE sum = 0;
+  for (const char* c = data; *c != '\0'; c++)
+  {
+    sum += *c;
+  }
+  int size = snprintf(frame, sizeof frame, "$%s#%02x", data, sum);
+  for (;;)
+  {
+    if (send_all(s, frame, size) != 0)
+    {
+      return -1;
+    }
+    if (!s->ack)
+    {
+      return 0;
+    }
+    int c;
+    do
+    {
+      c = get_byte(s);
+    } while (c >= 0 && c != '+' && c != '-');
+    if (c != '-')
+    {
+      return c < 0 ? -1 : 0;
+    }
+  }
+}
+
+// Devices get the write, everything else is patched, ROM included.
+static void poke(Machine* m, WORD address, BYTE value)
+{
+  if (m->host_page[address >> 8] == NULL)
+  {
+    mem_write(m, address, value);
+  }
+  else
+  {
+    mem_load(m, address, &value, 1);
+  }
+}
+
+// Register n as little endian hex, see gdbstub.h for the numbering.
+static int format_register(const CPU* cpu, int n, char* out)
+{
+  switch (n)
+  {
+  case 0:
+    return sprintf(out, "%02x", cpu->A);
+  case 1:
+    return sprintf(out, "%02x", cpu->X);
+  case 2:
+    return sprintf(out, "%02x", cpu->Y);
+  case 3:
+    return sprintf(out, "%02x", cpu->S);
+  case 4:
+    return sprintf(out, "%02x", cpu_status_byte(cpu));
+  case 5:
+    return sprintf(out, "%02x%02x", cpu->PC & 0xFF, cpu->PC >> 8);
+  default:
+    return -1;
+  }
+}
+
+// Sets register n from little endian hex at *text and moves past it.
+// Returns 0, or -1 for an unknown register or too few digits.
+static int parse_register(CPU* cpu, int n, const char** text)
+{
+  int size = n == 5 ? 2 : 1;
+  unsigned value = 0;
+  for (int i = 0; i < size; i++)
+  {
+    int high = hex_digit((*text)[0]);
+    int low = high < 0 ? -1 : hex_digit((*text)[1]);
+    if (low < 0)
+    {
+      return -1;
+    }
+    value |= (high << 4 | low) << (8 * i);
+    *text += 2;
+  }
+  switch (n)
+  {
+  case 0:
+    cpu->A = value;
+    break;
+  case 1:
+    cpu->X = value;
+    break;
+  case 2:
+    cpu->Y = value;
+    break;
+  case 3:
+    cpu->S = value;
+    break;
+  case 4:
+    cpu_set_status_byte(cpu, value);
+    break;
+  case 5:
+    cpu->PC = value;
+    break;
+  default:
+    return -1;
+  }
+  return 0;
+}
+
+// Sets (set != 0) or clears a Z packet's breakpoint or watchpoint. Returns 0,
+// or -1 for kinds that are not supported.
+static int change_point(Machine* m, int set, unsigned long type, WORD address,
+                        unsigned long length)
+{
+  static const int kinds[] = {[2] = WATCH_WRITE, [3] = WATCH_READ, [4] = WATCH_READ | WATCH_WRITE};
+  if (type <= 1)
+  {
+    // Software and hardware breakpoints are the same thing here.
+    if (set)
+    {
+      cpu_set_breakpoint(m, address);
+    }
+    else
+    {
+      cpu_clear_breakpoint(m, address);
+    }
+    return 0;
+  }
+  if (type > 4)
+  {
+    return -1;
+  }
+  for (unsigned long i = 0; i < length && i <= 0xFFFF; i++)
+  {
+    if (set)
+    {
+      cpu_set_watchpoint(m, address + i, kinds[type]);
+    }
+    else
+    {
+      cpu_clear_watchpoint(m, address + i, kinds[type]);
+    }
+  }
+  return 0;
+}
+
+// Runs until something stops the machine or the debugger interrupts, which
+// sets *interrupted.
+static StopReason run(Session* s, int* interrupted)
+{
+  Machine* m = s->m;
+  *interrupted = 0;
+  for (int first = 1;; first = 0)
+  {
+    // cpu_run() steps over a breakpoint it starts on.
+    if (!first && ADDRESS_BIT(m->breakpoints, m->cpu.PC))
+    {
+      return STOP_BREAKPOINT;
+    }
+    StopReason reason = cpu_run(m, RUN_SLICE);
+    if (reason != STOP_BUDGET)
+    {
+      return reason;
+    }
+    // Anything else the debugger sends stays buffered for read_packet().
+    struct pollfd p = {.fd = s->fd, .events = POLLIN};
+    if (s->input_used - s->input_read < sizeof s->input && poll(&p, 1, 0) > 0)
+    {
+      size_t seen = s->input_used - s->input_read;
+      if (receive(s) != 0)
+      {
+        *interrupted = 1;
+        return STOP_BUDGET;
+      }
+      BYTE* c = memchr(s->input + seen, 0x03, s->input_used - seen);
+      if (c != NULL)
+      {
+        memmove(c, c + 1, s->input + s->input_used - c - 1);
+        s->input_used--;
+        *interrupted = 1;
+        return STOP_BUDGET;
+      }
+    }
+  }
+}
+
+static void stop_reply(const Machine* m, StopReason reason, int interrupted, char* out)
+{
+  if (interrupted)
+  {
+    strcpy(out, "S02");
+  }
+  else if (reason == STOP_ILLEGAL)
+  {
+    strcpy(out, "S04");
+  }
+  else if (reason == STOP_WATCHPOINT)
+  {
+    WORD address = m->watch_address;
+    const char* kind = m->watch_hit == WATCH_READ ? "r" : "";
+    if (ADDRESS_BIT(m->watch_read, address) && ADDRESS_BIT(m->watch_write, address))
+    {
+      kind = "a";
+    }
+    sprintf(out, "T05%swatch:%04x;", kind, address);
+  }
+  else
+  {
+    strcpy(out, "S05");
+  }
+}
+
+#ifdef JOURNAL
+// Steps back once, or with cont until PC is on a breakpoint. Fills in the
+// stop reply.
+static void run_back(Machine* m, int cont, char* out)
+{
+  do
+  {
+    if (journal_step_back(m->journal, 1) == 0)
+    {
+      strcpy(out, "T05replaylog:begin;");
+      return;
+    }
+  } while (cont && !ADDRESS_BIT(m->breakpoints, m->cpu.PC));
+  strcpy(out, "S05");
+}
+#endif
+
+static void serve(Session* s)
+{
+  Machine* m = s->m;
+  CPU* cpu = &m->cpu;
+  while (read_packet(s) >= 0)
+  {
+    const char* p = s->packet + 1;
+    char* r = s->reply;
+    unsigned long address;
+    unsigned long length;
+    unsigned long n;
+    r[0] = '\0';
+    switch (s->packet[0])
+    {
+    case '?':
+      strcpy(r, "S05");
+      break;
+    case 'g':
+      for (int i = 0; i < 6; i++)
+      {
+        r += format_register(cpu, i, r);
+      }
+      break;
+    case 'G':
+    {
+      CPU changed = *cpu;
+      int bad = 0;
+      for (int i = 0; i < 6 && !bad; i++)
+      {
+        bad = parse_register(&changed, i, &p);
+      }
+      if (!bad)
+      {
+        *cpu = changed;
+      }
+      strcpy(r, bad ? "E01" : "OK");
+      break;
+    }
+    case 'p':
+      if (!parse_hex(&p, &n) || n > 5)
+      {
+        strcpy(r, "E01");
+        break;
+      }
+      format_register(cpu, n, r);
+      break;
+    case 'P':
+      if (!parse_hex(&p, &n) || *p++ != '=' || n > 5 || parse_register(cpu, n, &p) != 0)
+      {
+        strcpy(r, "E01");
+        break;
+      }
+      strcpy(r, "OK");
+      break;
+    case 'm':
+      if (!parse_hex(&p, &address) || *p++ != ',' || !parse_hex(&p, &length) ||
+          address > 0xFFFF || length > PACKET_SIZE / 2)
+      {
+        strcpy(r, "E01");
+        break;
+      }
+      for (unsigned long i = 0; i < length; i++)
+      {
+        r += sprintf(r, "%02x", mem_peek(m, address + i));
+      }
+      break;
+    case 'M':
+      if (!parse_hex(&p, &address) || *p++ != ',' || !parse_hex(&p, &length) || *p++ != ':' ||
+          address > 0xFFFF || strlen(p) < 2 * length)
+      {
+        strcpy(r, "E01");
+        break;
+      }
+      // All or nothing, so a bad digit leaves memory as it was.
+      n = 0;
+      while (n < 2 * length && hex_digit(p[n]) >= 0)
+      {
+        n++;
+      }
+      if (n < 2 * length)
+      {
+        strcpy(r, "E01");
+        break;
+      }
+      for (unsigned long i = 0; i < length; i++, p += 2)
+      {
+        poke(m, address + i, hex_digit(p[0]) << 4 | hex_digit(p[1]));
+      }
+      strcpy(r, "OK");
+      break;
+    case 'c':
+    case 's':
+    {
+      if (parse_hex(&p, &address))
+      {
+        cpu->PC = address;
+      }
+      int interrupted = 0;
+      StopReason reason = s->packet[0] == 's' ? cpu_run(m, 1) : run(s, &interrupted);
+      stop_reply(m, reason, interrupted, r);
+      break;
+    }
+#ifdef JOURNAL
+    case 'b':
+      if (m->journal != NULL && (*p == 's' || *p == 'c'))
+      {
+        run_back(m, *p == 'c', r);
+      }
+      break;
+#endif
+    case 'Z':
+    case 'z':
+    {
+      unsigned long type;
+      if (!parse_hex(&p, &type) || *p++ != ',' || !parse_hex(&p, &address) || *p++ != ',' ||
+          !parse_hex(&p, &length) || address > 0xFFFF)
+      {
+        strcpy(r, "E01");
+        break;
+      }
+      if (change_point(m, s->packet[0] == 'Z', type, address, length) == 0)
+      {
+        strcpy(r, "OK");
+      }
+      break;
+    }
+    case 'D':
+      send_packet(s, "OK");
+      return;
+    case 'k':
+      return;
+    case 'H':
+    case 'T':
+      strcpy(r, "OK");
+      break;
+    case 'q':
+      if (strncmp(p, "Supported", 9) == 0)
+      {
+        int reverse = 0;
+#ifdef JOURNAL
+        reverse = m->journal != NULL;
+#endif
+        sprintf(r, "PacketSize=%x;QStartNoAckMode+%s", PACKET_SIZE,
+                reverse ? ";ReverseStep+;ReverseContinue+" : "");
+      }
+      else if (strcmp(p, "Attached") == 0)
+      {
+        strcpy(r, "1");
+      }
+      break;
+    case 'Q':
+      if (strcmp(p, "StartNoAckMode") == 0)
+      {
+        if (send_packet(s, "OK") != 0)
+        {
+          return;
+        }
+        s->ack = 0;
+        continue;
+      }
+      break;
+    }
+    if (send_packet(s, s->reply) != 0)
+    {
+      return;
+    }
+  }
+}
+
+// Returns a listening socket, or -1 with errno set.
+static int listen_on(const char* where)
+{
+  int fd;
+  if (strchr(where, '/') != NULL)
+  {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(where) >= sizeof addr.sun_path)
+    {
+      errno = ENAMETOOLONG;
+      return -1;
+    }
+    strcpy(addr.sun_path, where);
+    // A socket left over from an earlier run would block the name.
+    struct stat st;
+    if (stat(where, &st) == 0 && S_ISSOCK(st.st_mode))
+    {
+      unlink(where);
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof addr) != 0)
+    {
+      goto fail;
+    }
+  }
+  else
+  {
+    char* end;
+    unsigned long port = strtoul(where, &end, 10);
+    if (*where == '\0' || *end != '\0' || port == 0 || port > 65535)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int on = 1;
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on) != 0 ||
+        bind(fd, (struct sockaddr*)&addr, sizeof addr) != 0)
+    {
+      goto fail;
+    }
+  }
+  if (listen(fd, 1) != 0)
+  {
+    goto fail;
+  }
+  return fd;
+fail:
+  if (fd >= 0)
+  {
+    int error = errno;
+    close(fd);
+    errno = error;
+  }
+  return -1;
+}
+
+int gdb_serve(Machine* m, const char* where)
+{
+  int listener = listen_on(where);
+  if (listener < 0)
+  {
+    return -1;
+  }
+  int fd;
+  do
+  {
+    fd = accept(listener, NULL, NULL);
+  } while (fd < 0 && errno == EINTR);
+  int error = errno;
+  close(listener);
+  if (strchr(where, '/') != NULL)
+  {
+    unlink(where);
+  }
+  if (fd < 0)
+  {
+    errno = error;
+    return -1;
+  }
+  // Packets are small and every one waits for an answer.
+  int on = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+  Session* s = calloc(1, sizeof *s);
+  if (s == NULL)
+  {
+    close(fd);
+    return -1;
+  }
+  s->m = m;
+  s->fd = fd;
+  s->ack = 1;
+  serve(s);
+  free(s);
+  close(fd);
+  return 0;
+}
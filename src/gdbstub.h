@@ -0,0 +1,40 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef GDBSTUB_H
+#define GDBSTUB_H
+
+#include "cpu.h"
+
+// GDB remote protocol stub, so a debugger can drive a machine. It speaks
+// enough of the protocol for gdb and similar front ends: registers, memory,
+// stepping, continuing (interrupted with Ctrl-C), breakpoints and read, write
+// and access watchpoints. With a journal on the machine (see journal.h) it
+// also steps and continues backwards.
+//
+// The registers are A, X, Y, S and P, one byte each, then PC as two bytes
+// little endian. Reading memory has no side effects, I/O pages read as FF.
+// A BRK that stops the machine is reported as a stop (S05) with PC on the
+// BRK, and the session carries on so the state there can be looked at.
+
+// Listens on where, a TCP port on the loopback address or, if it contains a
+// '/', the path of a Unix socket. Takes one connection and serves it until
+// the debugger detaches, kills the program or hangs up. Returns 0, or
+// -1 with errno set when the socket cannot be set up.
+int gdb_serve(Machine* m, const char* where);
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "journal.h"
+
+#include <stdlib.h>
+
+// The ring holds 32-bit entries. Bit 31 tells them apart: an instruction is
+// two entries with it clear, carrying PC, A, X, Y, S, P and the cycles the
+// instruction before it took, and every byte it writes follows as one entry
+// with it set, holding the address and the old value.
+#define WRITE_ENTRY 0x80000000u
+#define MIN_ENTRIES 64
+// Cycle gaps above this are cut off, only something other than an
+// instruction can make them.
+#define MAX_DELTA 63
+
+struct Journal
+{
+  Machine* machine;
+  unsigned* ring;
+  // A power of two.
+  size_t entries;
+  // Entries ever added and ever dropped; the oldest always starts an
+  // instruction.
+  unsigned long long head;
+  unsigned long long tail;
+  unsigned long depth;
+  // The machine's cycle count before the newest instruction.
+  unsigned long long cycles;
+};
+
+Journal* journal_start(Machine* m, size_t size)
+{
+  Journal* j = calloc(1, sizeof *j);
+  if (j == NULL)
+  {
+    return NULL;
+  }
+  j->entries = MIN_ENTRIES;
+  while (j->entries * 2 <= size / sizeof *j->ring)
+  {
+    j->entries *= 2;
+  }
+  j->ring = malloc(j->entries * sizeof *j->ring);
+  if (j->ring == NULL)
+  {
+    free(j);
+    return NULL;
+  }
+  j->machine = m;
+  journal_clear(j);
+  machine_set_journal(m, j);
+  return j;
+}
+
+void journal_stop(Journal* j)
+{
+  if (j == NULL)
+  {
+    return;
+  }
+  machine_set_journal(j->machine, NULL);
+  free(j->ring);
+  free(j);
+}
+
+void journal_clear(Journal* j)
+{
+  j->head = j->tail = 0;
+  j->depth = 0;
+  j->cycles = j->machine->cycles;
+}
+
+unsigned long journal_depth(const Journal* j)
+{
+  return j->depth;
+}
+
+// Drops the oldest instruction with its writes.
+static void drop_oldest(Journal* j)
+{
+  j->tail += 2;
+  while (j->tail != j->head && j->ring[j->tail & (j->entries - 1)] & WRITE_ENTRY)
+  {
+    j->tail++;
+  }
+  j->depth--;
+}
+
+static void add(Journal* j, unsigned entry)
+{
+  if (j->head - j->tail == j->entries)
+  {
+    drop_oldest(j);
+  }
+  j->ring[j->head++ & (j->entries - 1)] = entry;
+}
+
+void journal_record(Journal* j, const Machine* m)
+{
+  const CPU* cpu = &m->cpu;
+  unsigned long long delta = m->cycles - j->cycles;
+  unsigned long long state = cpu->PC | cpu->A << 16 | (unsigned long long)cpu->X << 24 |
+                             (unsigned long long)cpu->Y << 32 |
+                             (unsigned long long)cpu->S << 40 |
+                             (unsigned long long)cpu_status_byte(cpu) << 48 |
+                             (delta > MAX_DELTA ? MAX_DELTA : delta) << 56;
+  add(j, state & ~WRITE_ENTRY);
+  add(j, state >> 31);
+  j->depth++;
+  j->cycles = m->cycles;
+}
+
+void journal_write(Journal* j, WORD address, BYTE old)
+{
+  // Writes between runs belong to the instruction before them, if any.
+  if (j->depth != 0)
+  {
+    add(j, WRITE_ENTRY | address << 8 | old);
+  }
+}
+
+// Takes the newest instruction off the ring, undoing its writes when undo is
+// set. Returns the cycles the one before it took.
+static unsigned pop(Journal* j, int undo)
+{
+  Machine* m = j->machine;
+  unsigned entry;
+  while ((entry = j->ring[--j->head & (j->entries - 1)]) & WRITE_ENTRY)
+  {
+    BYTE old = entry;
+    if (undo)
+    {
+      mem_load(m, entry >> 8, &old, 1);
+    }
+  }
+  unsigned low = j->ring[--j->head & (j->entries - 1)];
+  unsigned long long state = (unsigned long long)entry << 31 | low;
+  if (undo)
+  {
+    CPU* cpu = &m->cpu;
+    cpu->PC = state;
+    cpu->A = state >> 16;
+    cpu->X = state >> 24;
+    cpu->Y = state >> 32;
+    cpu->S = state >> 40;
+    cpu_set_status_byte(cpu, state >> 48);
+    m->cycles = j->cycles;
+    m->instructions--;
+  }
+  j->depth--;
+  return state >> 56;
+}
+
+void journal_forget(Journal* j)
+{
+  j->cycles -= pop(j, 0);
+}
+
+unsigned long journal_step_back(Journal* j, unsigned long n)
+{
+  unsigned long undone = 0;
+  for (; undone < n && j->depth != 0; undone++)
+  {
+    j->cycles -= pop(j, 1);
+  }
+  return undone;
+}
+
+long journal_back_to_write(Journal* j, WORD address)
+{
+  unsigned long instructions = 0;
+  for (unsigned long long i = j->head; i != j->tail;)
+  {
+    unsigned entry = j->ring[--i & (j->entries - 1)];
+    if (!(entry & WRITE_ENTRY))
+    {
+      // The other half of the instruction.
+      i--;
+      instructions++;
+    }
+    else if ((WORD)(entry >> 8) == address)
+    {
+      return journal_step_back(j, instructions + 1);
+    }
+  }
+  return -1;
+}
@@ -0,0 +1,64 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stddef.h>
+
+#include "cpu.h"
+
+// Undo journal for running a machine backwards. With JOURNAL the core logs,
+// for every instruction a journaled machine runs, the registers it started
+// with and the old value of every RAM byte it overwrites. Undoing is popping
+// those off again, so stepping back costs about as much as stepping forward.
+// A journaled machine runs one instruction at a time, without the block cache
+// or idle loop skipping.
+//
+// The journal is a ring of fixed size: once full, the oldest instructions
+// fall out of it and can no longer be undone. Writes to devices cannot be
+// taken back and are not logged. Anything done to the machine outside
+// cpu_run() (mem_load, snapshot_restore, replay_seek) is not logged either,
+// so call journal_clear() after it.
+
+typedef struct Journal Journal;
+
+// Starts journaling m into a ring of about size bytes, 8 per instruction plus
+// 4 per byte written. Returns NULL when out of memory.
+Journal* journal_start(Machine* m, size_t size);
+// Stops journaling and frees j.
+void journal_stop(Journal* j);
+// Forgets all history, the machine's current state becomes the oldest.
+void journal_clear(Journal* j);
+// How many instructions can be undone.
+unsigned long journal_depth(const Journal* j);
+// Undoes the last n instructions, or as many as there are. Returns how many
+// were undone.
+unsigned long journal_step_back(Journal* j, unsigned long n);
+// Undoes instructions up to and including the last one that wrote address,
+// leaving the machine just before it. Returns how many were undone, or -1
+// without changing anything when no write to address is in the journal.
+long journal_back_to_write(Journal* j, WORD address);
+
+// Called by the core: journal_record() before every instruction,
+// journal_write() for every RAM byte it overwrites and journal_forget() when
+// it stopped the run instead of running.
+void journal_record(Journal* j, const Machine* m);
+void journal_write(Journal* j, WORD address, BYTE old);
+void journal_forget(Journal* j);
+
+#endif
@@ -0,0 +1,280 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "loader.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int check_fit(const char* path, long address, size_t size)
+{
+  if (size == 0)
+  {
+    fprintf(stderr, "%s: empty image\n", path);
+    return -1;
+  }
+  if (address + size > 0x10000)
+  {
+    fprintf(stderr, "%s: %zu bytes at %04lX do not fit in 64KB\n", path, size, address);
+    return -1;
+  }
+  return 0;
+}
+
+static void note_range(Image* image, WORD first, WORD last)
+{
+  if (image->first > first)
+  {
+    image->first = first;
+  }
+  if (image->last < last)
+  {
+    image->last = last;
+  }
+}
+
+// Returns 1 when data ended up mapped and must stay around.
+static int load_raw(Machine* m, const char* path, const BYTE* data, size_t size, WORD address,
+                    int rom, Image* image)
+{
+  if (check_fit(path, address, size) != 0)
+  {
+    return -1;
+  }
+  WORD last = address + size - 1;
+  note_range(image, address, last);
+  if (rom && (address & 0xFF) == 0)
+  {
+    // The mapping rounds up to whole host pages, which are larger than ours,
+    // so the tail of the last 256-byte page reads as zeros.
+    machine_map_rom(m, address, last, data);
+    return 1;
+  }
+  mem_load(m, address, data, size);
+  if (rom)
+  {
+    machine_map_rom(m, address, last, NULL);
+  }
+  return 0;
+}
+
+static int load_prg(Machine* m, const char* path, const BYTE* data, size_t size, int rom,
+                    Image* image)
+{
+  if (size < 2)
+  {
+    fprintf(stderr, "%s: no load address\n", path);
+    return -1;
+  }
+  WORD address = data[0] | data[1] << 8;
+  if (check_fit(path, address, size - 2) != 0)
+  {
+    return -1;
+  }
+  WORD last = address + (size - 2) - 1;
+  note_range(image, address, last);
+  mem_load(m, address, data + 2, size - 2);
+  if (rom)
+  {
+    machine_map_rom(m, address, last, NULL);
+  }
+  return 0;
+}
+
+static int hex_byte(const BYTE* p)
+{
+  int value = 0;
+  for (int i = 0; i < 2; i++)
+  {
+    BYTE c = p[i];
+    int digit = c >= '0' && c <= '9'   ? c - '0'
+                : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                                       : -1;
+    if (digit < 0)
+    {
+      return -1;
+    }
+    value = value << 4 | digit;
+  }
+  return value;
+}
+
+static int load_hex(Machine* m, const char* path, const BYTE* data, size_t size, int rom,
+                    Image* image)
+{
+  const BYTE* p = data;
+  const BYTE* end = data + size;
+  int line_no = 0;
+  while (p < end)
+  {
+    line_no++;
+    const BYTE* eol = memchr(p, '\n', end - p);
+    if (eol == NULL)
+    {
+      eol = end;
+    }
+    const BYTE* next = eol + (eol < end);
+    while (eol > p && (eol[-1] == '\r' || eol[-1] == ' ' || eol[-1] == '\t'))
+    {
+      eol--;
+    }
+    if (eol == p)
+    {
+      p = next;
+      continue;
+    }
+    // :LLAAAATT, LL data bytes and a checksum.
+    BYTE record[5 + 255 + 1];
+    size_t digits = eol - p - 1;
+    int length = eol - p >= 11 && *p == ':' && digits % 2 == 0 ? hex_byte(p + 1) : -1;
+    int sum = 0;
+    if (length >= 0 && digits / 2 == (size_t)length + 5)
+    {
+      for (int i = 0; i < length + 5; i++)
+      {
+        int value = hex_byte(p + 1 + 2 * i);
+        if (value < 0)
+        {
+          length = -1;
+          break;
+        }
+        record[i] = value;
+        sum += value;
+      }
+    }
+    else
+    {
+      length = -1;
+    }
+    if (length < 0)
+    {
+      fprintf(stderr, "%s:%d: not an Intel HEX record\n", path, line_no);
+      return -1;
+    }
+    if ((sum & 0xFF) != 0)
+    {
+      fprintf(stderr, "%s:%d: bad checksum\n", path, line_no);
+      return -1;
+    }
+    WORD address = record[1] << 8 | record[2];
+    switch (record[3])
+    {
+    case 0x00:
+      if (length == 0)
+      {
+        break;
+      }
+      if (check_fit(path, address, length) != 0)
+      {
+        return -1;
+      }
+      note_range(image, address, address + length - 1);
+      mem_load(m, address, record + 4, length);
+      if (rom)
+      {
+        machine_map_rom(m, address, address + length - 1, NULL);
+      }
+      break;
+    case 0x01:
+      return 0;
+    case 0x02:
+    case 0x04:
+      // Segment and upper address bits, only 0 makes sense for a 6502.
+      if (length != 2 || record[4] != 0 || record[5] != 0)
+      {
+        fprintf(stderr, "%s:%d: address beyond 64KB\n", path, line_no);
+        return -1;
+      }
+      break;
+    case 0x03:
+    case 0x05:
+      if (length == 4)
+      {
+        // CS:IP or a 32-bit linear address, the low 16 bits are all we use.
+        image->entry = record[6] << 8 | record[7];
+      }
+      break;
+    default:
+      fprintf(stderr, "%s:%d: unknown record type %02X\n", path, line_no, record[3]);
+      return -1;
+    }
+    p = next;
+  }
+  return 0;
+}
+
+int image_load(Machine* m, const char* path, WORD address, int rom, Image* image)
+{
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0)
+  {
+    perror(path);
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+    return -1;
+  }
+  size_t size = st.st_size;
+  const BYTE* data = NULL;
+  if (size > 0)
+  {
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+    {
+      perror(path);
+      close(fd);
+      return -1;
+    }
+    data = map;
+  }
+  close(fd);
+  image->first = 0xFFFF;
+  image->last = 0;
+  image->entry = -1;
+  const char* ext = strrchr(path, '.');
+  int result;
+  if (ext != NULL && strcasecmp(ext, ".prg") == 0)
+  {
+    result = load_prg(m, path, data, size, rom, image);
+  }
+  else if (ext != NULL && (strcasecmp(ext, ".hex") == 0 || strcasecmp(ext, ".ihx") == 0))
+  {
+    result = load_hex(m, path, data, size, rom, image);
+    if (result == 0 && image->first > image->last)
+    {
+      fprintf(stderr, "%s: no data records\n", path);
+      result = -1;
+    }
+  }
+  else
+  {
+    result = load_raw(m, path, data, size, address, rom, image);
+  }
+  if (result != 1 && data != NULL)
+  {
+    munmap((void*)data, size);
+  }
+  return result < 0 ? -1 : 0;
+}
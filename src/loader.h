@@ -0,0 +1,45 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "cpu.h"
+
+typedef struct
+{
+  // Lowest and highest address the image filled.
+  WORD first;
+  WORD last;
+  // Start address given by the file itself (Intel HEX record 03 or 05), -1
+  // when there is none.
+  long entry;
+} Image;
+
+// Loads a program image into m. The format comes from the file name:
+//
+//   .prg         Commodore style, the first two bytes are the load address
+//   .hex, .ihx   Intel HEX, every record carries its own address
+//   anything     raw bytes, loaded at address
+//
+// With rom set the pages the image touches become ROM. A raw image starting
+// on a page boundary is then mapped straight from the file without copying,
+// and stays mapped until the process exits. Returns 0 and fills image on
+// success, otherwise prints what went wrong and returns -1.
+int image_load(Machine* m, const char* path, WORD address, int rom, Image* image);
+
+#endif
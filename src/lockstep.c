@@ -0,0 +1,606 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "lockstep.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define LANES LOCKSTEP_LANES
+#define PAGE_CROSSED(a, b) ((((a) ^ (b)) & 0xFF00) != 0)
+
+// Every loop over the lanes is kept simple enough to become vector code: no
+// early exits, and lanes that sit this instruction out keep their values
+// through masks instead of branches. on[l] is 0xFF for lanes taking part.
+// GCC would otherwise unroll these short loops into scalar code before it
+// ever tries to vectorize them.
+#define FOR_LANES _Pragma("GCC unroll 1") for (int l = 0; l < LANES; l++)
+#define KEEP(field, value) g->field[l] = ((value) & on[l]) | (g->field[l] & ~on[l])
+#define KEEP_PC(value)                                                                             \
+  {                                                                                                \
+    WORD mask = on[l] | on[l] << 8;                                                                \
+    g->pc[l] = ((value) & mask) | (g->pc[l] & ~mask);                                              \
+  }
+#define SET_NZ(value)                                                                              \
+  KEEP(n_result, value);                                                                           \
+  KEEP(z_result, value)
+#define STATUS                                                                                     \
+  ((g->n_result[l] & 0x80) | g->v[l] << 6 | 0x20 | g->d[l] << 3 | g->i[l] << 2 |                   \
+   (g->z_result[l] == 0) << 1 | g->c[l])
+#define SET_STATUS(value)                                                                          \
+  KEEP(n_result, value);                                                                           \
+  KEEP(z_result, ~(value) & 0x02);                                                                 \
+  KEEP(c, (value) & 1);                                                                            \
+  KEEP(v, ((value) >> 6) & 1);                                                                     \
+  KEEP(d, ((value) >> 3) & 1);                                                                     \
+  KEEP(i, ((value) >> 2) & 1)
+#define PUSH(value)                                                                                \
+  KEEP(memory[0x100 | g->s[l]], value);                                                            \
+  KEEP(s, g->s[l] - 1)
+#define PULL(var)                                                                                  \
+  KEEP(s, g->s[l] + 1);                                                                            \
+  BYTE var = g->memory[0x100 | g->s[l]][l]
+
+Lockstep* lockstep_create(void)
+{
+  return calloc(1, sizeof(Lockstep));
+}
+
+void lockstep_destroy(Lockstep* g)
+{
+  free(g);
+}
+
+void lockstep_load(Lockstep* g, int lane, WORD address, const BYTE* data, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+  {
+    for (int l = 0; l < LANES; l++)
+    {
+      if (lane == -1 || lane == l)
+      {
+        g->memory[address + i][l] = data[i];
+      }
+    }
+  }
+}
+
+BYTE lockstep_read(const Lockstep* g, int lane, WORD address)
+{
+  return g->memory[address][lane];
+}
+
+void lockstep_reset(Lockstep* g)
+{
+  FOR_LANES
+  {
+    g->s[l] = 0xFD;
+    g->pc[l] = g->memory[0xFFFC][l] | g->memory[0xFFFD][l] << 8;
+    g->a[l] = g->x[l] = g->y[l] = 0;
+    g->n_result[l] = 0;
+    g->z_result[l] = 1;
+    g->c[l] = g->v[l] = 0;
+    g->i[l] = 1;
+  }
+}
+
+void lockstep_put(Lockstep* g, int lane, const Machine* m)
+{
+  const CPU* cpu = &m->cpu;
+  BYTE on[LANES] = {0};
+  int l = lane;
+  on[l] = 0xFF;
+  g->a[l] = cpu->A;
+  g->x[l] = cpu->X;
+  g->y[l] = cpu->Y;
+  g->s[l] = cpu->S;
+  g->pc[l] = cpu->PC;
+  BYTE p = cpu_status_byte(cpu);
+  SET_STATUS(p);
+  g->cycles[l] = m->cycles;
+  g->instructions[l] = m->instructions;
+  for (int i = 0; i < 0x10000; i++)
+  {
+    g->memory[i][l] = m->memory[i];
+  }
+}
+
+void lockstep_get(const Lockstep* g, int lane, Machine* m)
+{
+  CPU* cpu = &m->cpu;
+  int l = lane;
+  cpu->A = g->a[l];
+  cpu->X = g->x[l];
+  cpu->Y = g->y[l];
+  cpu->S = g->s[l];
+  cpu->PC = g->pc[l];
+  cpu_set_status_byte(cpu, STATUS);
+  m->cycles = g->cycles[l];
+  m->instructions = g->instructions[l];
+  // mem_load() so whatever the machine had decoded from there goes too, a
+  // page at a time.
+  BYTE page[256];
+  for (int i = 0; i < 0x10000; i += 256)
+  {
+    for (int j = 0; j < 256; j++)
+    {
+      page[j] = g->memory[i + j][l];
+    }
+    mem_load(m, i, page, sizeof page);
+  }
+}
+
+// Decimal mode is rare enough to leave to the core's own ADC and SBC, one lane
+// at a time.
+static int any_decimal(const Lockstep* g, const BYTE* on)
+{
+  BYTE any = 0;
+  FOR_LANES
+  {
+    any |= on[l] & g->d[l];
+  }
+  return any;
+}
+
+static void decimal(Lockstep* g, const BYTE* on, int l, BYTE value, void (*op)(CPU*, BYTE))
+{
+  CPU cpu = {0};
+  cpu.A = g->a[l];
+  cpu_set_status_byte(&cpu, STATUS);
+  op(&cpu, value);
+  BYTE p = cpu_status_byte(&cpu);
+  KEEP(a, cpu.A);
+  SET_STATUS(p);
+}
+
+// ADDRESS_<mode> works out the effective address: one addr for all lanes when
+// it only depends on the operand, else at[] with one per lane. READ_<mode> and
+// WRITE_<mode> are used inside a loop over the lanes. They use lockstep_run()'s
+// g, on, operand and next.
+#define ADDRESS_IMPLIED(penalty)
+#define ADDRESS_ACCUMULATOR(penalty)
+#define ADDRESS_IMMEDIATE(penalty)
+#define ADDRESS_RELATIVE(penalty)
+#define ADDRESS_ZEROPAGE(penalty) WORD addr = (BYTE)operand
+#define ADDRESS_ABSOLUTE(penalty) WORD addr = operand
+#define ADDRESS_ZEROPAGE_X(penalty)                                                                \
+  WORD at[LANES];                                                                                  \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    at[l] = (BYTE)(operand + g->x[l]);                                                             \
+  }
+#define ADDRESS_ZEROPAGE_Y(penalty)                                                                \
+  WORD at[LANES];                                                                                  \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    at[l] = (BYTE)(operand + g->y[l]);                                                             \
+  }
+#define INDEXED(base, index, penalty)                                                              \
+  at[l] = (base) + (index);                                                                        \
+  ticks[l] += on[l] & (penalty) & PAGE_CROSSED(base, at[l])
+#define ADDRESS_ABSOLUTE_X(penalty)                                                                \
+  WORD at[LANES];                                                                                  \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    INDEXED(operand, g->x[l], penalty);                                                            \
+  }
+#define ADDRESS_ABSOLUTE_Y(penalty)                                                                \
+  WORD at[LANES];                                                                                  \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    INDEXED(operand, g->y[l], penalty);                                                            \
+  }
+// The pointer's high byte comes from the same page, as on the real chip.
+#define ADDRESS_INDIRECT(penalty)                                                                  \
+  WORD at[LANES];                                                                                  \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    at[l] = g->memory[operand][l] | g->memory[(operand & 0xFF00) | (BYTE)(operand + 1)][l] << 8;   \
+  }
+#define ADDRESS_INDIRECT_X(penalty)                                                                \
+  WORD at[LANES];                                                                                  \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    BYTE ptr = operand + g->x[l];                                                                  \
+    at[l] = g->memory[ptr][l] | g->memory[(BYTE)(ptr + 1)][l] << 8;                                \
+  }
+#define ADDRESS_INDIRECT_Y(penalty)                                                                \
+  WORD at[LANES];                                                                                  \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    WORD base = g->memory[(BYTE)operand][l] | g->memory[(BYTE)(operand + 1)][l] << 8;              \
+    INDEXED(base, g->y[l], penalty);                                                               \
+  }
+
+#define ADDRESS_OF_ZEROPAGE addr
+#define ADDRESS_OF_ABSOLUTE addr
+#define ADDRESS_OF_ZEROPAGE_X at[l]
+#define ADDRESS_OF_ZEROPAGE_Y at[l]
+#define ADDRESS_OF_ABSOLUTE_X at[l]
+#define ADDRESS_OF_ABSOLUTE_Y at[l]
+#define ADDRESS_OF_INDIRECT at[l]
+#define ADDRESS_OF_INDIRECT_X at[l]
+#define ADDRESS_OF_INDIRECT_Y at[l]
+
+#define MEMORY(mode) g->memory[ADDRESS_OF_##mode][l]
+#define READ_ACCUMULATOR g->a[l]
+#define READ_IMMEDIATE (BYTE)operand
+#define READ_ZEROPAGE MEMORY(ZEROPAGE)
+#define READ_ZEROPAGE_X MEMORY(ZEROPAGE_X)
+#define READ_ZEROPAGE_Y MEMORY(ZEROPAGE_Y)
+#define READ_ABSOLUTE MEMORY(ABSOLUTE)
+#define READ_ABSOLUTE_X MEMORY(ABSOLUTE_X)
+#define READ_ABSOLUTE_Y MEMORY(ABSOLUTE_Y)
+#define READ_INDIRECT_X MEMORY(INDIRECT_X)
+#define READ_INDIRECT_Y MEMORY(INDIRECT_Y)
+
+#define WRITE_ACCUMULATOR(value) KEEP(a, value)
+#define WRITE_MEMORY(mode, value) KEEP(memory[ADDRESS_OF_##mode], value)
+#define WRITE_ZEROPAGE(value) WRITE_MEMORY(ZEROPAGE, value)
+#define WRITE_ZEROPAGE_X(value) WRITE_MEMORY(ZEROPAGE_X, value)
+#define WRITE_ZEROPAGE_Y(value) WRITE_MEMORY(ZEROPAGE_Y, value)
+#define WRITE_ABSOLUTE(value) WRITE_MEMORY(ABSOLUTE, value)
+#define WRITE_ABSOLUTE_X(value) WRITE_MEMORY(ABSOLUTE_X, value)
+#define WRITE_ABSOLUTE_Y(value) WRITE_MEMORY(ABSOLUTE_Y, value)
+#define WRITE_INDIRECT_X(value) WRITE_MEMORY(INDIRECT_X, value)
+#define WRITE_INDIRECT_Y(value) WRITE_MEMORY(INDIRECT_Y, value)
+
+// The instructions, the same ones cpu.c has but for all lanes at once.
+#define LOAD(reg, mode)                                                                            \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    BYTE val = READ_##mode;                                                                        \
+    KEEP(reg, val);                                                                                \
+    SET_NZ(val);                                                                                   \
+  }
+#define STORE(reg, mode)                                                                           \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    WRITE_##mode(g->reg[l]);                                                                       \
+  }
+#define TRANSFER(to, from)                                                                         \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    BYTE val = g->from[l];                                                                         \
+    KEEP(to, val);                                                                                 \
+    SET_NZ(val);                                                                                   \
+  }
+#define EXECUTE_LDA(mode) LOAD(a, mode)
+#define EXECUTE_LDX(mode) LOAD(x, mode)
+#define EXECUTE_LDY(mode) LOAD(y, mode)
+#define EXECUTE_STA(mode) STORE(a, mode)
+#define EXECUTE_STX(mode) STORE(x, mode)
+#define EXECUTE_STY(mode) STORE(y, mode)
+#define EXECUTE_TAX(mode) TRANSFER(x, a)
+#define EXECUTE_TAY(mode) TRANSFER(y, a)
+#define EXECUTE_TSX(mode) TRANSFER(x, s)
+#define EXECUTE_TXA(mode) TRANSFER(a, x)
+#define EXECUTE_TYA(mode) TRANSFER(a, y)
+#define EXECUTE_TXS(mode)                                                                          \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    KEEP(s, g->x[l]);                                                                              \
+  }
+
+#define LOGIC(op, mode)                                                                            \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    BYTE val = g->a[l] op READ_##mode;                                                             \
+    KEEP(a, val);                                                                                  \
+    SET_NZ(val);                                                                                   \
+  }
+#define EXECUTE_AND(mode) LOGIC(&, mode)
+#define EXECUTE_ORA(mode) LOGIC(|, mode)
+#define EXECUTE_EOR(mode) LOGIC(^, mode)
+// SBC is ADC of the inverted value, as far as the binary result goes.
+#define ADD(mode, invert, op)                                                                      \
+  if (any_decimal(g, on))                                                                          \
+  {                                                                                                \
+    FOR_LANES                                                                                      \
+    {                                                                                              \
+      if (on[l])                                                                                   \
+      {                                                                                            \
+        decimal(g, on, l, READ_##mode, op);                                                        \
+      }                                                                                            \
+    }                                                                                              \
+  }                                                                                                \
+  else                                                                                             \
+  {                                                                                                \
+    FOR_LANES                                                                                      \
+    {                                                                                              \
+      BYTE val = READ_##mode ^ (invert);                                                           \
+      WORD sum = g->a[l] + val + g->c[l];                                                          \
+      KEEP(v, ((~(g->a[l] ^ val) & (g->a[l] ^ sum)) >> 7) & 1);                                    \
+      KEEP(c, sum >> 8);                                                                           \
+      KEEP(a, (BYTE)sum);                                                                          \
+      SET_NZ((BYTE)sum);                                                                           \
+    }                                                                                              \
+  }
+#define EXECUTE_ADC(mode) ADD(mode, 0x00, cpu_adc)
+#define EXECUTE_SBC(mode) ADD(mode, 0xFF, cpu_sbc)
+#define COMPARE(reg, mode)                                                                         \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    BYTE val = READ_##mode;                                                                        \
+    KEEP(c, g->reg[l] >= val);                                                                     \
+    SET_NZ((BYTE)(g->reg[l] - val));                                                               \
+  }
+#define EXECUTE_CMP(mode) COMPARE(a, mode)
+#define EXECUTE_CPX(mode) COMPARE(x, mode)
+#define EXECUTE_CPY(mode) COMPARE(y, mode)
+#define EXECUTE_BIT(mode)                                                                          \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    BYTE val = READ_##mode;                                                                        \
+    KEEP(z_result, val & g->a[l]);                                                                 \
+    KEEP(n_result, val);                                                                           \
+    KEEP(v, (val >> 6) & 1);                                                                       \
+  }
+
+// Read-modify-write of val: result gets written back, carry is the new C.
+#define MODIFY(mode, result, carry)                                                                \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    BYTE val = READ_##mode;                                                                        \
+    BYTE out = result;                                                                             \
+    KEEP(c, carry);                                                                                \
+    WRITE_##mode(out);                                                                             \
+    SET_NZ(out);                                                                                   \
+  }
+#define EXECUTE_INC(mode) MODIFY(mode, val + 1, g->c[l])
+#define EXECUTE_DEC(mode) MODIFY(mode, val - 1, g->c[l])
+#define EXECUTE_ASL(mode) MODIFY(mode, val << 1, val >> 7)
+#define EXECUTE_LSR(mode) MODIFY(mode, val >> 1, val & 1)
+#define EXECUTE_ROL(mode) MODIFY(mode, (val << 1) | g->c[l], val >> 7)
+#define EXECUTE_ROR(mode) MODIFY(mode, (val >> 1) | (g->c[l] << 7), val & 1)
+#define STEP(reg, delta)                                                                           \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    BYTE val = g->reg[l] + (delta);                                                                \
+    KEEP(reg, val);                                                                                \
+    SET_NZ(val);                                                                                   \
+  }
+#define EXECUTE_INX(mode) STEP(x, 1)
+#define EXECUTE_INY(mode) STEP(y, 1)
+#define EXECUTE_DEX(mode) STEP(x, -1)
+#define EXECUTE_DEY(mode) STEP(y, -1)
+
+// All lanes here share PC, so only whether the branch is taken differs.
+#define BRANCH(taken)                                                                              \
+  WORD target = next + (SBYTE)operand;                                                             \
+  BYTE extra = 1 + PAGE_CROSSED(next, target);                                                     \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    BYTE go = on[l] & -(taken);                                                                    \
+    WORD mask = go | go << 8;                                                                      \
+    g->pc[l] = (target & mask) | (g->pc[l] & ~mask);                                               \
+    ticks[l] += go & extra;                                                                        \
+  }
+#define EXECUTE_BCC(mode) BRANCH(g->c[l] == 0)
+#define EXECUTE_BCS(mode) BRANCH(g->c[l] != 0)
+#define EXECUTE_BNE(mode) BRANCH(g->z_result[l] != 0)
+#define EXECUTE_BEQ(mode) BRANCH(g->z_result[l] == 0)
+#define EXECUTE_BPL(mode) BRANCH((g->n_result[l] & 0x80) == 0)
+#define EXECUTE_BMI(mode) BRANCH((g->n_result[l] & 0x80) != 0)
+#define EXECUTE_BVC(mode) BRANCH(g->v[l] == 0)
+#define EXECUTE_BVS(mode) BRANCH(g->v[l] != 0)
+#define EXECUTE_JMP(mode)                                                                          \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    KEEP_PC(ADDRESS_OF_##mode);                                                                    \
+  }
+#define EXECUTE_JSR(mode)                                                                          \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    PUSH((WORD)(next - 1) >> 8);                                                                   \
+    PUSH((BYTE)(next - 1));                                                                        \
+    KEEP_PC(addr);                                                                                 \
+  }
+#define EXECUTE_RTS(mode)                                                                          \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    PULL(low);                                                                                     \
+    PULL(high);                                                                                    \
+    KEEP_PC((high << 8 | low) + 1);                                                                \
+  }
+#define EXECUTE_RTI(mode)                                                                          \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    PULL(p);                                                                                       \
+    SET_STATUS(p);                                                                                 \
+    PULL(low);                                                                                     \
+    PULL(high);                                                                                    \
+    KEEP_PC(high << 8 | low);                                                                      \
+  }
+#define EXECUTE_PHA(mode)                                                                          \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    PUSH(g->a[l]);                                                                                 \
+  }
+#define EXECUTE_PLA(mode)                                                                          \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    PULL(val);                                                                                     \
+    KEEP(a, val);                                                                                  \
+    SET_NZ(val);                                                                                   \
+  }
+#define EXECUTE_PHP(mode)                                                                          \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    PUSH(STATUS | 0x30);                                                                           \
+  }
+#define EXECUTE_PLP(mode)                                                                          \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    PULL(p);                                                                                       \
+    SET_STATUS(p);                                                                                 \
+  }
+// Only with brk_interrupt, lockstep_run() stops the lanes otherwise.
+#define EXECUTE_BRK(mode)                                                                          \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    PUSH(next >> 8);                                                                               \
+    PUSH(next & 0xFF);                                                                             \
+    PUSH(STATUS | 0x30);                                                                           \
+    KEEP(i, 1);                                                                                    \
+    KEEP_PC(g->memory[0xFFFE][l] | g->memory[0xFFFF][l] << 8);                                     \
+  }
+
+#define FLAG(flag, value)                                                                          \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    KEEP(flag, value);                                                                             \
+  }
+#define EXECUTE_CLC(mode) FLAG(c, 0)
+#define EXECUTE_SEC(mode) FLAG(c, 1)
+#define EXECUTE_CLV(mode) FLAG(v, 0)
+#define EXECUTE_CLD(mode) FLAG(d, 0)
+#define EXECUTE_SED(mode) FLAG(d, 1)
+#define EXECUTE_CLI(mode) FLAG(i, 0)
+#define EXECUTE_SEI(mode) FLAG(i, 1)
+#define EXECUTE_NOP(mode)
+
+void lockstep_run(Lockstep* g, int lanes, unsigned long budget)
+{
+  // Cycles and instructions add up in bytes and go into the 64 bit counters
+  // every 16 steps, at most 8 cycles a step cannot overflow them. Wide
+  // counters on every step would cost more than the instructions themselves.
+  BYTE ticks[LANES] = {0};
+  BYTE count[LANES] = {0};
+  // Lanes that stopped look like they sit at 0x10000, past every real PC.
+  WORD waiting[LANES];
+  FOR_LANES
+  {
+    waiting[l] = l < lanes ? 0 : 0xFFFF;
+  }
+#define FLUSH                                                                                      \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    g->cycles[l] += ticks[l];                                                                      \
+    g->instructions[l] += count[l];                                                                \
+    ticks[l] = count[l] = 0;                                                                       \
+  }
+  // Every step runs an instruction on at least one lane, so no lane can use
+  // up its budget before that many steps have gone by.
+  unsigned long long start[LANES];
+  FOR_LANES
+  {
+    start[l] = g->instructions[l];
+  }
+  for (unsigned long step = 0;; step++)
+  {
+    if ((step & 15) == 0)
+    {
+      FLUSH;
+    }
+    unsigned pc = 0x10000;
+    FOR_LANES
+    {
+      unsigned at = (g->pc[l] | waiting[l]) + (waiting[l] & 1);
+      pc = at < pc ? at : pc;
+    }
+    if (pc == 0x10000)
+    {
+      FLUSH;
+      return;
+    }
+    BYTE on[LANES];
+    FOR_LANES
+    {
+      on[l] = -(g->pc[l] == pc) & ~waiting[l];
+    }
+    if (step >= budget)
+    {
+      FOR_LANES
+      {
+        if (on[l] && g->instructions[l] + count[l] - start[l] == budget)
+        {
+          g->reason[l] = STOP_BUDGET;
+          waiting[l] = 0xFFFF;
+          on[l] = 0;
+        }
+      }
+    }
+    int lead = 0;
+    while (lead < LANES && !on[lead])
+    {
+      lead++;
+    }
+    if (lead == LANES)
+    {
+      continue;
+    }
+    // The instruction is the first lane's. Lanes holding other code there
+    // wait, they get their turn once the others have moved on.
+    WORD second = pc + 1;
+    WORD third = pc + 2;
+    BYTE op_code = g->memory[pc][lead];
+    BYTE length = instruction_length[op_code];
+    BYTE low = length > 1 ? g->memory[second][lead] : 0;
+    BYTE high = length > 2 ? g->memory[third][lead] : 0;
+    FOR_LANES
+    {
+      BYTE same = (g->memory[pc][l] == op_code) & ((length < 2) | (g->memory[second][l] == low)) &
+                  ((length < 3) | (g->memory[third][l] == high));
+      on[l] &= -same;
+    }
+    WORD operand = low | high << 8;
+    WORD next = pc + length;
+    // Like execute(), BRK and unknown opcodes stop with PC left on them.
+#define STOP_LANES(why)                                                                            \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    if (on[l])                                                                                     \
+    {                                                                                              \
+      g->reason[l] = (why);                                                                        \
+      waiting[l] = 0xFFFF;                                                                         \
+    }                                                                                              \
+  }
+    if (op_code == BRK && !g->brk_interrupt)
+    {
+      STOP_LANES(STOP_BRK);
+      continue;
+    }
+#define CHARGE(base)                                                                               \
+  FOR_LANES                                                                                        \
+  {                                                                                                \
+    KEEP_PC(next);                                                                                 \
+    ticks[l] += on[l] & (base);                                                                    \
+    count[l] += on[l] & 1;                                                                         \
+  }
+#define HANDLER(name, code, mnemonic, mode, bytes, cycles, penalty, flags)                         \
+  case name:                                                                                       \
+  {                                                                                                \
+    CHARGE(cycles);                                                                                \
+    ADDRESS_##mode(penalty);                                                                       \
+    EXECUTE_##mnemonic(mode);                                                                      \
+    break;                                                                                         \
+  }
+#define NO_HANDLER(code)
+    switch (op_code)
+    {
+      OPCODE_TABLE(HANDLER, NO_HANDLER)
+    default:
+      STOP_LANES(STOP_ILLEGAL);
+    }
+#undef STOP_LANES
+#undef CHARGE
+#undef FLUSH
+#undef HANDLER
+#undef NO_HANDLER
+  }
+}
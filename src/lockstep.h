@@ -0,0 +1,83 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <stddef.h>
+
+#include "cpu.h"
+
+// Lockstep engine: up to LOCKSTEP_LANES copies of one program, each over its
+// own data, run together instruction by instruction. Registers, flags and
+// memory are kept per lane side by side, so one instruction is fetched and
+// dispatched once and then carried out for all lanes by loops the compiler
+// turns into vector code.
+//
+// Lanes that branch apart are masked: the lanes with the lowest PC run, the
+// others wait, so they meet up again where the paths join. A lane running on
+// its own is just a scalar machine that happens to be slow.
+//
+// A lane is plain 64KB of RAM. There are no devices, ROM, breakpoints, traces
+// or snapshots; move a lane into a Machine with lockstep_get() for those and
+// carry on with cpu_run().
+
+#define LOCKSTEP_LANES 16
+
+typedef struct
+{
+  // One slot per lane. Flags are kept like LAZY_FLAGS does: N is bit 7 of
+  // n_result and Z is z_result == 0. The others are 0 or 1.
+  BYTE a[LOCKSTEP_LANES];
+  BYTE x[LOCKSTEP_LANES];
+  BYTE y[LOCKSTEP_LANES];
+  BYTE s[LOCKSTEP_LANES];
+  WORD pc[LOCKSTEP_LANES];
+  BYTE n_result[LOCKSTEP_LANES];
+  BYTE z_result[LOCKSTEP_LANES];
+  BYTE c[LOCKSTEP_LANES];
+  BYTE v[LOCKSTEP_LANES];
+  BYTE d[LOCKSTEP_LANES];
+  BYTE i[LOCKSTEP_LANES];
+  unsigned long long cycles[LOCKSTEP_LANES];
+  unsigned long long instructions[LOCKSTEP_LANES];
+  // Why each lane stopped in the last lockstep_run().
+  StopReason reason[LOCKSTEP_LANES];
+  // Same as Machine.brk_interrupt, for all lanes.
+  BYTE brk_interrupt;
+  // memory[address][lane], so an address is one row for all lanes.
+  BYTE memory[1 * 64 * 1024][LOCKSTEP_LANES];
+} Lockstep;
+
+// All lanes zeroed. Returns NULL when out of memory.
+Lockstep* lockstep_create(void);
+void lockstep_destroy(Lockstep* g);
+// Copies data into one lane's memory at address, or every lane's for lane -1.
+// size must not run past 0xFFFF.
+void lockstep_load(Lockstep* g, int lane, WORD address, const BYTE* data, size_t size);
+BYTE lockstep_read(const Lockstep* g, int lane, WORD address);
+// cpu_reset() for every lane.
+void lockstep_reset(Lockstep* g);
+// Copy a lane from or into a machine: CPU, counters and memory[]. Devices and
+// ROM images that do not live in memory[] are left out.
+void lockstep_put(Lockstep* g, int lane, const Machine* m);
+void lockstep_get(const Lockstep* g, int lane, Machine* m);
+// Runs lanes 0 to lanes - 1 until each one has executed budget instructions
+// or stopped on its own, see reason.
+void lockstep_run(Lockstep* g, int lanes, unsigned long budget);
+
+#endif
@@ -15,1350 +15,638 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
-// 8bit;
-typedef unsigned char BYTE;
-// 16bit;
-typedef unsigned short WORD;
-typedef char SBYTE;
-typedef short SWORD;
-// Memory for 6502 (64KB)
-BYTE memory[1 * 64 * 1024];
-// Not a good idea but why not
-typedef struct
-{
-  unsigned N : 1;
-  unsigned V : 1;
-  unsigned U : 1;
-  unsigned B : 1;
-  unsigned D : 1;
-  unsigned I : 1;
-  unsigned Z : 1;
-  unsigned C : 1;
-} Status;
-typedef struct
-{
-  BYTE A;
-  BYTE X;
-  BYTE Y;
-  WORD PC;
-  BYTE S;
-  Status P;
-} CPU;
+#include <unistd.h>
+
+#include "console.h"
+#include "cpu.h"
+#include "disasm.h"
+#include "gdbstub.h"
+#ifdef JOURNAL
+#include "journal.h"
+#endif
+#include "loader.h"
+#include "memmap.h"
+#include "replay.h"
+#ifdef PROFILE
+#include "profile.h"
+#endif
+#ifdef TRACE
+#include "trace.h"
+#endif
 
-BYTE mem_read(WORD address)
+static void usage(const char* name)
 {
-  return memory[address];
+  fprintf(stderr,
+          "usage: %s [-m memory.map] [-t trace.bin] [-l image [-a load-address]] "
+          "[-r reset-address] [-p] [-R recording [-S instruction]] [-w address] "
+          "[-g port|socket] [-c address]\n",
+          name);
 }
 
-void mem_write(WORD address, BYTE value)
+static int parse_address(const char* text, WORD* address)
 {
-  memory[address] = value;
+  char* end;
+  unsigned long value = strtoul(text, &end, 16);
+  if (*text == '\0' || *end != '\0' || value > 0xFFFF)
+  {
+    fprintf(stderr, "'%s' is not a hex address\n", text);
+    return -1;
+  }
+  *address = value;
+  return 0;
 }
-void cpu_reset(CPU* cpu)
+
+// Keyframes are 64KB each, one per million instructions keeps seeking fast and
+// a long run in memory.
+#define RECORDING_INTERVAL 1000000
+
+#ifdef JOURNAL
+// Enough for the last few million instructions.
+#define JOURNAL_SIZE (64 << 20)
+
+// Takes m back to just before the last instruction that wrote address and
+// prints it.
+static void show_last_write(Journal* j, Machine* m, WORD address)
 {
-  cpu->S = 0xFD;
-  BYTE low = memory[0xFFFC];
-  BYTE high = memory[0xFFFD];
-  cpu->PC = ((WORD)high << 8) | low;
-  cpu->A = cpu->X = cpu->Y = 0;
-  cpu->P.U = 1;
+  unsigned long depth = journal_depth(j);
+  long back = journal_back_to_write(j, address);
+  if (back < 0)
+  {
+    printf("No write to $%04X in the last %lu instructions\n", address, depth);
+    return;
+  }
+  CPU* cpu = &m->cpu;
+  char text[32];
+  disasm(text, sizeof text, cpu->PC, mem_peek(m, cpu->PC),
+         mem_peek(m, cpu->PC + 1) | mem_peek(m, cpu->PC + 2) << 8);
+  printf("Last write to $%04X, %ld instructions back: %04X  %s  A=%02X X=%02X Y=%02X S=%02X\n",
+         address, back, cpu->PC, text, cpu->A, cpu->X, cpu->Y, cpu->S);
 }
-// TODO: Implement more op_code.
-// Also we do not care about cycle right now.
-// TODO: ASL, BIT, EOR, ORA
-#define LDA_IMMEDIATE 0xA9
-#define LDA_ZEROPAGE 0xA5
-#define LDA_ZEROPAGE_X 0xB5
-#define LDA_ABSOLUTE 0xAD
-#define LDA_ABSOLUTE_X 0xBD
-#define LDA_ABSOLUTE_Y 0xB9
-#define LDA_INDIRECT_X 0xA1
-#define LDA_INDIRECT_Y 0xB1
-#define LDX_IMMEDIATE 0xA2
-#define LDX_ZEROPAGE 0xA6
-#define LDX_ZEROPAGE_Y 0xB6
-#define LDX_ABSOLUTE 0xAE
-#define LDX_ABSOLUTE_Y 0xBE
-#define LDY_IMMEDIATE 0xA0
-#define LDY_ZEROPAGE 0xA4
-#define LDY_ZEROPAGE_X 0xB4
-#define LDY_ABSOLUTE 0xAC
-#define LDY_ABSOLUTE_X 0xBC
-#define STA_ZEROPAGE 0x85
-#define STA_ZEROPAGE_X 0x95
-#define STA_ABSOLUTE 0x8D
-#define STA_ABSOLUTE_X 0x9D
-#define STA_ABSOLUTE_Y 0x99
-#define STA_INDIRECT_X 0x81
-#define STA_INDIRECT_Y 0x91
-#define STX_ZEROPAGE 0x86
-#define STX_ZEROPAGE_Y 0x96
-#define STX_ABSOLUTE 0x8E
-#define STY_ZEROPAGE 0x84
-#define STY_ZEROPAGE_X 0x94
-#define STY_ABSOLUTE 0x8C
-#define TAX 0xAA
-#define TAY 0xA8
-#define TSX 0xBA
-#define TXA 0x8A
-#define TXS 0x9A
-#define TYA 0x98
-#define SEC 0x38
-#define SED 0xF8
-#define SEI 0x78
-#define BRK 0x00
-#define NOP 0xEA
-#define INX 0xE8
-#define INY 0xC8
-#define CLC 0x18
-#define CLD 0xD8
-#define CLI 0x58
-#define CLV 0xB8
-#define BCC 0x90
-#define BCS 0xB0
-#define BEQ 0xF0
-#define BMI 0x30
-#define BNE 0xD0
-#define BPL 0x10
-#define BVC 0x50
-#define BVS 0x70
-#define INC_ZEROPAGE 0xE6
-#define INC_ZEROPAGE_X 0xF6
-#define INC_ABSOLUTE 0xEE
-#define INC_ABSOLUTE_X 0xFE
-#define DEC_ZEROPAGE 0xC6
-#define DEC_ZEROPAGE_X 0xD6
-#define DEC_ABSOLUTE 0xCE
-#define DEC_ABSOLUTE_X 0xDE
-#define DEX 0xCA
-#define DEY 0x88
-#define ADC_IMMEDIATE 0x69
-#define ADC_ZEROPAGE 0x65
-#define ADC_ZEROPAGE_X 0x75
-#define ADC_ABSOLUTE 0x6D
-#define ADC_ABSOLUTE_X 0x7D
-#define ADC_ABSOLUTE_Y 0x79
-#define ADC_INDIRECT_X 0x61
-#define ADC_INDIRECT_Y 0x71
-#define AND_IMMEDIATE 0x29
-#define AND_ZEROPAGE 0x25
-#define AND_ZEROPAGE_X 0x35
-#define AND_ABSOLUTE 0x2D
-#define AND_ABSOLUTE_X 0x3D
-#define AND_ABSOLUTE_Y 0x39
-#define AND_INDIRECT_X 0x21
-#define AND_INDIRECT_Y 0x31
-#define ORA_IMMEDIATE 0x09
-#define ORA_ZEROPAGE 0x05
-#define ORA_ZEROPAGE_X 0x15
-#define ORA_ABSOLUTE 0x0D
-#define ORA_ABSOLUTE_X 0x1D
-#define ORA_ABSOLUTE_Y 0x19
-#define ORA_INDIRECT_X 0x01
-#define ORA_INDIRECT_Y 0x11
-#define EOR_IMMEDIATE 0x49
-#define EOR_ZEROPAGE 0x45
-#define EOR_ZEROPAGE_X 0x55
-#define EOR_ABSOLUTE 0x4D
-#define EOR_ABSOLUTE_X 0x5D
-#define EOR_ABSOLUTE_Y 0x59
-#define EOR_INDIRECT_X 0x41
-#define EOR_INDIRECT_Y 0x51
-#define ASL_ACCUMULATOR 0x0A
-#define ASL_ZEROPAGE 0x06
-#define ASL_ZEROPAGE_X 0x16
-#define ASL_ABSOLUTE 0x0E
-#define ASL_ABSOLUTE_X 0x1E
-#define BIT_ZEROPAGE 0x24
-#define BIT_ABSOLUTE 0x2C
-void setZN(CPU* cpu, BYTE val)
+#endif
+
+// The built-in program that runs when no image is given.
+static void load_demo(Machine* m)
 {
-  cpu->P.Z = (val == 0);
-  cpu->P.N = (val & 0x80) != 0;
-  cpu->P.U = 1;
+  mem_write(m, 0x8000, LDA_IMMEDIATE);
+  mem_write(m, 0x8001, 0x10);
+  mem_write(m, 0x8002, LDA_ZEROPAGE);
+  mem_write(m, 0x8003, 0x20);
+  mem_write(m, 0x8004, LDA_ZEROPAGE_X);
+  mem_write(m, 0x8005, 0x1D);
+  mem_write(m, 0x8006, LDA_ABSOLUTE);
+  mem_write(m, 0x8007, 0x00);
+  mem_write(m, 0x8008, 0x90);
+  mem_write(m, 0x8009, LDA_ABSOLUTE_X);
+  mem_write(m, 0x800A, 0x01);
+  mem_write(m, 0x800B, 0x90);
+  mem_write(m, 0x800C, LDA_ABSOLUTE_Y);
+  mem_write(m, 0x800D, 0x02);
+  mem_write(m, 0x800E, 0x90);
+  mem_write(m, 0x800F, LDA_INDIRECT_X);
+  mem_write(m, 0x8010, 0x30);
+  mem_write(m, 0x8011, LDA_INDIRECT_Y);
+  mem_write(m, 0x8012, 0x31);
+  // LDX
+  mem_write(m, 0x8013, LDX_IMMEDIATE);
+  mem_write(m, 0x8014, 0x03);
+  mem_write(m, 0x8015, LDX_ZEROPAGE);
+  mem_write(m, 0x8016, 0x21);
+  mem_write(m, 0x8017, LDX_ZEROPAGE_Y);
+  mem_write(m, 0x8018, 0x22);
+  mem_write(m, 0x8019, LDX_ABSOLUTE);
+  mem_write(m, 0x801A, 0x01);
+  mem_write(m, 0x801B, 0x90);
+  mem_write(m, 0x801C, LDX_ABSOLUTE_Y);
+  mem_write(m, 0x801D, 0x02);
+  mem_write(m, 0x801E, 0x90);
+
+  // LDY
+  mem_write(m, 0x801F, LDY_IMMEDIATE);
+  mem_write(m, 0x8020, 0x04);
+  mem_write(m, 0x8021, LDY_ZEROPAGE);
+  mem_write(m, 0x8022, 0x22);
+  mem_write(m, 0x8023, LDY_ZEROPAGE_X);
+  mem_write(m, 0x8024, 0x1E);
+  mem_write(m, 0x8025, LDY_ABSOLUTE);
+  mem_write(m, 0x8026, 0x02);
+  mem_write(m, 0x8027, 0x90);
+  mem_write(m, 0x8028, LDY_ABSOLUTE_X);
+  mem_write(m, 0x8029, 0x01);
+  mem_write(m, 0x802A, 0x90);
+
+  // STA/STX/STY
+  mem_write(m, 0x802B, STA_ZEROPAGE);
+  mem_write(m, 0x802C, 0x40);
+  mem_write(m, 0x802D, STA_ZEROPAGE_X);
+  mem_write(m, 0x802E, 0x41);
+  mem_write(m, 0x802F, STA_ABSOLUTE);
+  mem_write(m, 0x8030, 0x00);
+  mem_write(m, 0x8031, 0x90);
+  mem_write(m, 0x8032, STA_ABSOLUTE_X);
+  mem_write(m, 0x8033, 0x01);
+  mem_write(m, 0x8034, 0x90);
+  mem_write(m, 0x8035, STA_ABSOLUTE_Y);
+  mem_write(m, 0x8036, 0x02);
+  mem_write(m, 0x8037, 0x90);
+  mem_write(m, 0x8038, STA_INDIRECT_X);
+  mem_write(m, 0x8039, 0x50);
+  mem_write(m, 0x803A, STA_INDIRECT_Y);
+  mem_write(m, 0x803B, 0x51);
+
+  mem_write(m, 0x803C, STX_ZEROPAGE);
+  mem_write(m, 0x803D, 0x42);
+  mem_write(m, 0x803E, STX_ZEROPAGE_Y);
+  mem_write(m, 0x803F, 0x43);
+  mem_write(m, 0x8040, STX_ABSOLUTE);
+  mem_write(m, 0x8041, 0x03);
+  mem_write(m, 0x8042, 0x90);
+
+  mem_write(m, 0x8043, STY_ZEROPAGE);
+  mem_write(m, 0x8044, 0x44);
+  mem_write(m, 0x8045, STY_ZEROPAGE_X);
+  mem_write(m, 0x8046, 0x45);
+  mem_write(m, 0x8047, STY_ABSOLUTE);
+  mem_write(m, 0x8048, 0x04);
+  mem_write(m, 0x8049, 0x90);
+
+  // Transfers
+  mem_write(m, 0x804A, TAX);
+  mem_write(m, 0x804B, TAY);
+  mem_write(m, 0x804C, TSX);
+  mem_write(m, 0x804D, TXA);
+  mem_write(m, 0x804E, TXS);
+  mem_write(m, 0x804F, TYA);
+
+  // INC/DEC
+  mem_write(m, 0x8050, INC_ZEROPAGE);
+  mem_write(m, 0x8051, 0x60);
+  mem_write(m, 0x8052, INC_ZEROPAGE_X);
+  mem_write(m, 0x8053, 0x61);
+  mem_write(m, 0x8054, INC_ABSOLUTE);
+  mem_write(m, 0x8055, 0x9000 & 0xFF);
+  mem_write(m, 0x8056, 0x9000 >> 8);
+  mem_write(m, 0x8057, INC_ABSOLUTE_X);
+  mem_write(m, 0x8058, 0x9003 & 0xFF);
+  mem_write(m, 0x8059, 0x9003 >> 8);
+
+  mem_write(m, 0x805A, DEC_ZEROPAGE);
+  mem_write(m, 0x805B, 0x62);
+  mem_write(m, 0x805C, DEC_ZEROPAGE_X);
+  mem_write(m, 0x805D, 0x63);
+  mem_write(m, 0x805E, DEC_ABSOLUTE);
+  mem_write(m, 0x805F, 0x9000 & 0xFF);
+  mem_write(m, 0x8060, 0x9000 >> 8);
+  mem_write(m, 0x8061, DEC_ABSOLUTE_X);
+  mem_write(m, 0x8062, 0x9003 & 0xFF);
+  mem_write(m, 0x8063, 0x9003 >> 8);
+
+  mem_write(m, 0x8064, INX);
+  mem_write(m, 0x8065, INY);
+
+  // ADC tests
+  mem_write(m, 0x8066, ADC_IMMEDIATE);
+  mem_write(m, 0x8067, 0x10);
+  mem_write(m, 0x8068, ADC_ZEROPAGE);
+  mem_write(m, 0x8069, 0x20);
+  mem_write(m, 0x806A, ADC_ZEROPAGE_X);
+  mem_write(m, 0x806B, 0x1D);
+  mem_write(m, 0x806C, ADC_ABSOLUTE);
+  mem_write(m, 0x806D, 0x00);
+  mem_write(m, 0x806E, 0x90);
+  mem_write(m, 0x806F, ADC_ABSOLUTE_X);
+  mem_write(m, 0x8070, 0x01);
+  mem_write(m, 0x8071, 0x90);
+  mem_write(m, 0x8072, ADC_ABSOLUTE_Y);
+  mem_write(m, 0x8073, 0x02);
+  mem_write(m, 0x8074, 0x90);
+  mem_write(m, 0x8075, ADC_INDIRECT_X);
+  mem_write(m, 0x8076, 0x30);
+  mem_write(m, 0x8077, ADC_INDIRECT_Y);
+  mem_write(m, 0x8078, 0x31);
+
+  // AND tests
+  mem_write(m, 0x8079, AND_IMMEDIATE);
+  mem_write(m, 0x807A, 0x0F);
+  mem_write(m, 0x807B, AND_ZEROPAGE);
+  mem_write(m, 0x807C, 0x20);
+  mem_write(m, 0x807D, AND_ZEROPAGE_X);
+  mem_write(m, 0x807E, 0x1D);
+  mem_write(m, 0x807F, AND_ABSOLUTE);
+  mem_write(m, 0x8080, 0x00);
+  mem_write(m, 0x8081, 0x90);
+  mem_write(m, 0x8082, AND_ABSOLUTE_X);
+  mem_write(m, 0x8083, 0x01);
+  mem_write(m, 0x8084, 0x90);
+  mem_write(m, 0x8085, AND_ABSOLUTE_Y);
+  mem_write(m, 0x8086, 0x02);
+  mem_write(m, 0x8087, 0x90);
+  mem_write(m, 0x8088, AND_INDIRECT_X);
+  mem_write(m, 0x8089, 0x30);
+  mem_write(m, 0x808A, AND_INDIRECT_Y);
+  mem_write(m, 0x808B, 0x31);
+
+  // Original Flag setup
+  mem_write(m, 0x808C, CLC);
+  mem_write(m, 0x808D, SEC);
+  mem_write(m, 0x808E, SED);
+  mem_write(m, 0x808F, SEI);
+
+  // --- NEWLY ADDED TESTS (ORA, EOR, BIT, ASL, DEGS, FLAGS) ---
+  // Starting at 0x8090
+
+  // ORA (Logical OR) Tests
+  mem_write(m, 0x8090, ORA_IMMEDIATE);
+  mem_write(m, 0x8091, 0x01);
+  mem_write(m, 0x8092, ORA_ZEROPAGE);
+  mem_write(m, 0x8093, 0x20);
+  mem_write(m, 0x8094, ORA_ZEROPAGE_X);
+  mem_write(m, 0x8095, 0x1D);
+  mem_write(m, 0x8096, ORA_ABSOLUTE);
+  mem_write(m, 0x8097, 0x00);
+  mem_write(m, 0x8098, 0x90);
+  mem_write(m, 0x8099, ORA_ABSOLUTE_X);
+  mem_write(m, 0x809A, 0x01);
+  mem_write(m, 0x809B, 0x90);
+  mem_write(m, 0x809C, ORA_ABSOLUTE_Y);
+  mem_write(m, 0x809D, 0x02);
+  mem_write(m, 0x809E, 0x90);
+  mem_write(m, 0x809F, ORA_INDIRECT_X);
+  mem_write(m, 0x80A0, 0x30);
+  mem_write(m, 0x80A1, ORA_INDIRECT_Y);
+  mem_write(m, 0x80A2, 0x31);
+
+  // EOR (Exclusive OR) Tests
+  mem_write(m, 0x80A3, EOR_IMMEDIATE);
+  mem_write(m, 0x80A4, 0xFF);
+  mem_write(m, 0x80A5, EOR_ZEROPAGE);
+  mem_write(m, 0x80A6, 0x20);
+  mem_write(m, 0x80A7, EOR_ZEROPAGE_X);
+  mem_write(m, 0x80A8, 0x1D);
+  mem_write(m, 0x80A9, EOR_ABSOLUTE);
+  mem_write(m, 0x80AA, 0x00);
+  mem_write(m, 0x80AB, 0x90);
+  mem_write(m, 0x80AC, EOR_ABSOLUTE_X);
+  mem_write(m, 0x80AD, 0x01);
+  mem_write(m, 0x80AE, 0x90);
+  mem_write(m, 0x80AF, EOR_ABSOLUTE_Y);
+  mem_write(m, 0x80B0, 0x02);
+  mem_write(m, 0x80B1, 0x90);
+  mem_write(m, 0x80B2, EOR_INDIRECT_X);
+  mem_write(m, 0x80B3, 0x30);
+  mem_write(m, 0x80B4, EOR_INDIRECT_Y);
+  mem_write(m, 0x80B5, 0x31);
+
+  // BIT Tests
+  mem_write(m, 0x80B6, BIT_ZEROPAGE);
+  mem_write(m, 0x80B7, 0x20);
+  mem_write(m, 0x80B8, BIT_ABSOLUTE);
+  mem_write(m, 0x80B9, 0x00);
+  mem_write(m, 0x80BA, 0x90);
+
+  // ASL (Arithmetic Shift Left) Tests
+  mem_write(m, 0x80BB, ASL_ACCUMULATOR);
+  mem_write(m, 0x80BC, ASL_ZEROPAGE);
+  mem_write(m, 0x80BD, 0x20);
+  mem_write(m, 0x80BE, ASL_ZEROPAGE_X);
+  mem_write(m, 0x80BF, 0x1D);
+  mem_write(m, 0x80C0, ASL_ABSOLUTE);
+  mem_write(m, 0x80C1, 0x00);
+  mem_write(m, 0x80C2, 0x90);
+  mem_write(m, 0x80C3, ASL_ABSOLUTE_X);
+  mem_write(m, 0x80C4, 0x01);
+  mem_write(m, 0x80C5, 0x90);
+
+  // DEX/DEY
+  mem_write(m, 0x80C6, DEX);
+  mem_write(m, 0x80C7, DEY);
+
+  // Flag Clears
+  mem_write(m, 0x80C8, CLD);
+  mem_write(m, 0x80C9, CLI);
+  mem_write(m, 0x80CA, CLV);
+
+  mem_write(m, 0x80CB, NOP);
+  mem_write(m, 0x80CC, NOP);
+  mem_write(m, 0x80CD, BRK);
+
+  mem_write(m, 0x0020, 0xAA);
+  mem_write(m, 0x0021, 0xBB);
+  mem_write(m, 0x0022, 0xCC);
+  mem_write(m, 0x0030, 0x01); // Indirect Pointer Low
+  mem_write(m, 0x0031, 0x00); // Indirect Pointer High (Added for safety)
+  mem_write(m, 0x0033, 0x05);
+
+  mem_write(m, 0x9000, 0x11);
+  mem_write(m, 0x9001, 0x22);
+  mem_write(m, 0x9002, 0x33);
+  mem_write(m, 0x9003, 0x44);
+  mem_write(m, 0x9006, 0x66);
 }
-void execute(CPU* cpu)
+
+int main(int argc, char** argv)
 {
-  BYTE op_code = mem_read(cpu->PC++);
-  switch (op_code)
-  {
-  case LDA_IMMEDIATE:
-  {
-    cpu->A = mem_read(cpu->PC++);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case LDA_ZEROPAGE:
-  {
-    BYTE addr = mem_read(cpu->PC++);
-    cpu->A = mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case LDA_ZEROPAGE_X:
-  {
-    BYTE base = mem_read(cpu->PC++);
-    BYTE addr = (BYTE)(base + cpu->X) & 0xFF;
-    cpu->A = mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case LDA_ABSOLUTE:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    cpu->A = mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case LDA_ABSOLUTE_X:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    addr = (addr + (WORD)cpu->X) & 0xFFFF;
-    cpu->A = mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case LDA_ABSOLUTE_Y:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    addr = (addr + (WORD)cpu->Y) & 0xFFFF;
-    cpu->A = mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case LDA_INDIRECT_X:
-  {
-    BYTE ptr = mem_read(cpu->PC++);
-    BYTE addr_ptr = (BYTE)(ptr + cpu->X);
-    BYTE first_addr = mem_read(addr_ptr);
-    BYTE second_addr = mem_read((addr_ptr + 0x01) & 0xFF);
-    WORD addr = (second_addr << 8) | first_addr;
-    cpu->A = mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case LDA_INDIRECT_Y:
-  {
-    BYTE addr_ptr = mem_read(cpu->PC++);
-    BYTE first_addr = mem_read(addr_ptr);
-    BYTE second_addr = mem_read((addr_ptr + 0x01) & 0xFF);
-    WORD addr = (second_addr << 8) | first_addr;
-    cpu->A = mem_read((addr + cpu->Y) & 0xFFFF);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case LDX_IMMEDIATE:
-  {
-    cpu->X = mem_read(cpu->PC++);
-    setZN(cpu, cpu->X);
-    break;
-  }
-  case LDX_ZEROPAGE:
-  {
-    BYTE addr = mem_read(cpu->PC++);
-    cpu->X = mem_read(addr);
-    setZN(cpu, cpu->X);
-    break;
-  }
-  case LDX_ZEROPAGE_Y:
-  {
-    BYTE base = mem_read(cpu->PC++);
-    BYTE addr = (BYTE)(base + cpu->Y) & 0xFF;
-    cpu->X = mem_read(addr);
-    setZN(cpu, cpu->X);
-    break;
-  }
-  case LDX_ABSOLUTE:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    cpu->X = mem_read(addr);
-    setZN(cpu, cpu->X);
-    break;
-  }
-  case LDX_ABSOLUTE_Y:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (((second_addr << 8) | first_addr) + cpu->Y) & 0xFFFF;
-    cpu->X = mem_read(addr);
-    setZN(cpu, cpu->X);
-    break;
-  }
-  case LDY_IMMEDIATE:
-  {
-    cpu->Y = mem_read(cpu->PC++);
-    setZN(cpu, cpu->Y);
-    break;
-  }
-  case LDY_ZEROPAGE:
-  {
-    BYTE addr = mem_read(cpu->PC++);
-    cpu->Y = mem_read(addr);
-    setZN(cpu, cpu->Y);
-    break;
-  }
-  case LDY_ZEROPAGE_X:
-  {
-    BYTE base = mem_read(cpu->PC++);
-    BYTE addr = (BYTE)(base + cpu->X) & 0xFF;
-    cpu->Y = mem_read(addr);
-    setZN(cpu, cpu->Y);
-    break;
-  }
-  case LDY_ABSOLUTE:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    cpu->Y = mem_read(addr);
-    setZN(cpu, cpu->Y);
-    break;
-  }
-  case LDY_ABSOLUTE_X:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (((second_addr << 8) | first_addr) + cpu->X) & 0xFFFF;
-    cpu->Y = mem_read(addr);
-    setZN(cpu, cpu->Y);
-    break;
-  }
-  case STA_ZEROPAGE:
-  {
-    BYTE addr = mem_read(cpu->PC++);
-    BYTE value_A = cpu->A;
-    mem_write((WORD)addr, value_A);
-    break;
-  }
-  case STA_ZEROPAGE_X:
-  {
-    BYTE addr = (mem_read(cpu->PC++) + cpu->X) & 0xFF;
-    mem_write((WORD)addr, cpu->A);
-    break;
-  }
-  case STA_ABSOLUTE:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    mem_write(addr, cpu->A);
-    break;
-  }
-  case STA_ABSOLUTE_X:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (((second_addr << 8) | first_addr) + cpu->X) & 0xFFFF;
-    mem_write(addr, cpu->A);
-    break;
-  }
-  case STA_ABSOLUTE_Y:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (((second_addr << 8) | first_addr) + cpu->Y) & 0xFFFF;
-    mem_write(addr, cpu->A);
-    break;
-  }
-  case STA_INDIRECT_X:
-  {
-    BYTE ptr = mem_read(cpu->PC++);
-    BYTE addr_ptr = (ptr + cpu->X) & 0xFF;
-    BYTE first_addr = mem_read(addr_ptr);
-    BYTE second_addr = mem_read((addr_ptr + 0x01) & 0xFF);
-    WORD addr = (second_addr << 8) | first_addr;
-    mem_write(addr, cpu->A);
-    break;
-  }
-  case STA_INDIRECT_Y:
-  {
-    BYTE addr_ptr = mem_read(cpu->PC++);
-    BYTE first_addr = mem_read(addr_ptr);
-    BYTE second_addr = mem_read((addr_ptr + 0x01) & 0xFF);
-    WORD addr = (((second_addr << 8) | first_addr) + cpu->Y) & 0xFFFF;
-    mem_write(addr, cpu->A);
-    break;
-  }
-  case STX_ZEROPAGE:
-  {
-    BYTE addr = mem_read(cpu->PC++);
-    BYTE value_X = cpu->X;
-    mem_write((WORD)addr, value_X);
-    break;
-  }
-  case STX_ZEROPAGE_Y:
-  {
-    BYTE addr = (mem_read(cpu->PC++) + cpu->Y) & 0xFF;
-    mem_write((WORD)addr, cpu->X);
-    break;
-  }
-  case STX_ABSOLUTE:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    mem_write(addr, cpu->X);
-    break;
+  const char* map_path = NULL;
+  const char* trace_path = NULL;
+  int profile = 0;
+  const char* image_path = NULL;
+  WORD load_address = 0x8000;
+  WORD start;
+  int have_start = 0;
+  const char* recording_path = NULL;
+  unsigned long long seek = 0;
+  int have_seek = 0;
+  WORD watch;
+  int have_watch = 0;
+  const char* gdb = NULL;
+  WORD console_address;
+  int have_console = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "m:t:l:a:r:pR:S:w:g:c:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'c':
+      if (parse_address(optarg, &console_address) != 0)
+      {
+        return 2;
+      }
+      have_console = 1;
+      break;
+    case 'g':
+      gdb = optarg;
+      break;
+    case 'R':
+      recording_path = optarg;
+      break;
+    case 'w':
+      if (parse_address(optarg, &watch) != 0)
+      {
+        return 2;
+      }
+      have_watch = 1;
+      break;
+    case 'S':
+    {
+      char* end;
+      errno = 0;
+      seek = strtoull(optarg, &end, 10);
+      if (*optarg == '\0' || *end != '\0' || errno != 0)
+      {
+        fprintf(stderr, "'%s' is not an instruction count\n", optarg);
+        return 2;
+      }
+      have_seek = 1;
+      break;
+    }
+    case 'l':
+      image_path = optarg;
+      break;
+    case 'a':
+      if (parse_address(optarg, &load_address) != 0)
+      {
+        return 2;
+      }
+      break;
+    case 'r':
+      if (parse_address(optarg, &start) != 0)
+      {
+        return 2;
+      }
+      have_start = 1;
+      break;
+    case 'm':
+      map_path = optarg;
+      break;
+    case 't':
+      trace_path = optarg;
+      break;
+    case 'p':
+      profile = 1;
+      break;
+    default:
+      usage(argv[0]);
+      return 2;
+    }
   }
-  case STY_ZEROPAGE:
+  if (have_seek && recording_path == NULL)
   {
-    BYTE addr = mem_read(cpu->PC++);
-    mem_write((WORD)addr, cpu->Y);
-    break;
+    usage(argv[0]);
+    return 2;
   }
-  case STY_ZEROPAGE_X:
+  Machine* m = machine_create();
+  if (m == NULL)
   {
-    BYTE addr = (mem_read(cpu->PC++) + cpu->X) & 0xFF;
-    mem_write((WORD)addr, cpu->Y);
-    break;
+    return 1;
   }
-  case STY_ABSOLUTE:
+  if (map_path != NULL && memmap_load(m, map_path) != 0)
   {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    mem_write(addr, cpu->Y);
-    break;
+    machine_destroy(m);
+    return 1;
   }
-  case INC_ZEROPAGE:
+  CPU* cpu = &m->cpu;
+  Image image;
+  if (image_path == NULL)
   {
-    BYTE addr = mem_read(cpu->PC++);
-    BYTE val = mem_read(addr);
-    val = (val + 1) & 0xFF;
-    mem_write(addr, val);
-    setZN(cpu, val);
-    break;
+    mem_write(m, 0xFFFC, 0x00);
+    mem_write(m, 0xFFFD, 0x80);
+    load_demo(m);
   }
-  case INC_ZEROPAGE_X:
+  else if (image_load(m, image_path, load_address, 0, &image) != 0)
   {
-    BYTE addr = mem_read(cpu->PC++);
-    addr = (addr + cpu->X) & 0xFF;
-    BYTE val = mem_read(addr);
-    val = (val + 1) & 0xFF;
-    mem_write(addr, val);
-    setZN(cpu, val);
-    break;
+    machine_destroy(m);
+    return 1;
   }
-  case INC_ABSOLUTE:
+  if (have_start)
   {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    BYTE val = mem_read(addr);
-    val = (val + 1) & 0xFF;
-    mem_write(addr, val);
-    setZN(cpu, val);
-    break;
+    cpu_reset_to(m, start);
   }
-  case INC_ABSOLUTE_X:
+  else if (image_path != NULL && (image.first > 0xFFFC || image.last < 0xFFFD))
   {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (((second_addr << 8) | first_addr) + cpu->X) & 0xFFFF;
-    BYTE val = mem_read(addr);
-    val = (val + 1) & 0xFF;
-    mem_write(addr, val);
-    setZN(cpu, val);
-    break;
+    // The image did not bring its own reset vector.
+    cpu_reset_to(m, image.entry >= 0 ? image.entry : image.first);
   }
-  case BCC:
+  else
   {
-    SBYTE offset = mem_read(cpu->PC++);
-    if (cpu->P.C == 0)
+    cpu_reset(m);
+    if (image_path != NULL && image.entry >= 0)
     {
-      cpu->PC = (cpu->PC + offset) & 0xFFFF;
+      cpu->PC = image.entry;
     }
-    break;
   }
-  case BCS:
-  {
-    SBYTE offset = mem_read(cpu->PC++);
-    if (cpu->P.C == 1)
+  printf("CPU reset complete. PC = 0x%04X, S = 0x%02X, U = %d, X = 0x%02X\n", cpu->PC, cpu->S,
+         cpu->P.U, cpu->X);
+  // Before replaying or recording, which take over its page.
+  Console* console = NULL;
+  if (have_console)
+  {
+    // What the guest prints comes after what was printed so far.
+    fflush(stdout);
+    // An IRQ bit of its own, memory map devices count up from bit 0.
+    console = console_open(m, 1u << MEMMAP_IRQ_BITS, STDIN_FILENO, STDOUT_FILENO);
+    if (console == NULL)
     {
-      cpu->PC = (cpu->PC + offset) & 0xFFFF;
+      perror("console");
+      machine_destroy(m);
+      return 1;
     }
-    break;
+    console_map(console, console_address, console_address);
   }
-  case BEQ:
+  // Replaying needs the same map and image as the run that was recorded.
+  Recording* recording = NULL;
+  if (have_seek)
   {
-    SBYTE offset = mem_read(cpu->PC++);
-    if (cpu->P.Z == 1)
+    recording = recording_load(recording_path);
+    if (recording == NULL)
     {
-      cpu->PC = (cpu->PC + offset) & 0xFFFF;
+      perror(recording_path);
+      machine_destroy(m);
+      return 1;
     }
-    break;
-  }
-  case BMI:
-  {
-    SBYTE offset = mem_read(cpu->PC++);
-    if (cpu->P.N == 1)
+    if (replay_seek(recording, m, seek) != 0)
     {
-      cpu->PC = (cpu->PC + offset) & 0xFFFF;
+      fprintf(stderr, "%s: instruction %llu is not between %llu and %llu\n", recording_path, seek,
+              recording_first(recording), recording_last(recording));
+      recording_destroy(recording);
+      machine_destroy(m);
+      return 1;
     }
-    break;
+    printf("Replaying from instruction %llu. PC = 0x%04X\n", seek, cpu->PC);
   }
-  case BNE:
+  if (trace_path != NULL)
   {
-    SBYTE offset = mem_read(cpu->PC++);
-    if (cpu->P.Z == 0)
+#ifdef TRACE
+    m->trace = trace_open(trace_path);
+    if (m->trace == NULL)
     {
-      cpu->PC = (cpu->PC + offset) & 0xFFFF;
+      perror(trace_path);
+      machine_destroy(m);
+      return 1;
     }
-    break;
+#else
+    fprintf(stderr, "%s: built without TRACE\n", argv[0]);
+    machine_destroy(m);
+    return 1;
+#endif
   }
-  case BPL:
+  if (profile)
   {
-    SBYTE offset = mem_read(cpu->PC++);
-    if (cpu->P.N == 0)
+#ifdef PROFILE
+    m->profile = profile_create();
+    if (m->profile == NULL)
     {
-      cpu->PC = (cpu->PC + offset) & 0xFFFF;
+      machine_destroy(m);
+      return 1;
     }
-    break;
-  }
-  case BVC:
-  {
-    SBYTE offset = mem_read(cpu->PC++);
-    if (cpu->P.V == 0)
+#else
+    fprintf(stderr, "%s: built without PROFILE\n", argv[0]);
+    machine_destroy(m);
+    return 1;
+#endif
+  }
+#ifdef JOURNAL
+  // The debugger gets a journal too, to step backwards.
+  Journal* journal = NULL;
+  if (have_watch || gdb != NULL)
+  {
+    journal = journal_start(m, JOURNAL_SIZE);
+    if (journal == NULL)
     {
-      cpu->PC = (cpu->PC + offset) & 0xFFFF;
+      machine_destroy(m);
+      return 1;
     }
-    break;
-  }
-  case BVS:
-  {
-    SBYTE offset = mem_read(cpu->PC++);
-    if (cpu->P.V == 1)
-    {
-      cpu->PC = (cpu->PC + offset) & 0xFFFF;
-    }
-    break;
-  }
-  case INX:
-  {
-    cpu->X = (cpu->X + 1) & 0xFF;
-    setZN(cpu, cpu->X);
-    break;
-  }
-  case INY:
-  {
-    cpu->Y = (cpu->Y + 1) & 0xFF;
-    setZN(cpu, cpu->Y);
-    break;
-  }
-  case DEC_ZEROPAGE:
-  {
-    BYTE addr = mem_read(cpu->PC++);
-    BYTE val = mem_read(addr);
-    val = (val - 1) & 0xFF;
-    mem_write(addr, val);
-    setZN(cpu, val);
-    break;
-  }
-  case DEC_ZEROPAGE_X:
-  {
-    BYTE addr = mem_read(cpu->PC++);
-    addr = (addr + cpu->X) & 0xFF;
-    BYTE val = mem_read(addr);
-    val = (val - 1) & 0xFF;
-    mem_write(addr, val);
-    setZN(cpu, val);
-    break;
-  }
-  case DEC_ABSOLUTE:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    BYTE val = mem_read(addr);
-    val = (val - 1) & 0xFF;
-    mem_write(addr, val);
-    setZN(cpu, val);
-    break;
-  }
-  case DEC_ABSOLUTE_X:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (((second_addr << 8) | first_addr) + cpu->X) & 0xFFFF;
-    BYTE val = mem_read(addr);
-    val = (val - 1) & 0xFF;
-    mem_write(addr, val);
-    setZN(cpu, val);
-    break;
-  }
-  case ADC_IMMEDIATE:
-  {
-    // We can just add the carry flag. Even if it does not set.
-    // Because if set, C = 1, if not, then C = 0
-    BYTE to_add = mem_read(cpu->PC++);
-    WORD result = cpu->A + cpu->P.C + to_add;
-    cpu->P.C = (result & 0x100) != 0;
-    // Overflow (V) is set when (+) + (+) = - or (-) + (-) = +
-    // We detect it by looking at the sign bit (bit 7).
-    // A ^ to_add tells if the signs of A and operand differ (1 = different, 0 = same)
-    // Negate it (~) now 1 indicates the operands have the same sign
-    // A ^ result tells if the result’s sign differs from A (1 = sign changed)
-    // AND both conditions will give 1 if same-sign operands produced a sign-flipped result
-    // & 0x80 to isolate the sign bit for the V flag
-    cpu->P.V = ((~(cpu->A ^ to_add) & (cpu->A ^ (BYTE)(result)) & 0x80) != 0);
-    cpu->A = (BYTE)(result) & 0xFF;
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case ADC_ZEROPAGE:
-  {
-    BYTE addr = mem_read(cpu->PC++);
-    BYTE val = mem_read(addr);
-    WORD result = cpu->A + cpu->P.C + val;
-    cpu->P.C = (result & 0x100) != 0;
-    cpu->P.V = ((~(cpu->A ^ val) & (cpu->A ^ (BYTE)(result)) & 0x80) != 0);
-
-    cpu->A = (BYTE)(result) & 0xFF;
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case ADC_ZEROPAGE_X:
-  {
-    BYTE base = mem_read(cpu->PC++);
-    BYTE addr = (BYTE)(base + cpu->X) & 0xFF;
-    BYTE val = mem_read(addr);
-    WORD result = cpu->A + cpu->P.C + val;
-    cpu->P.C = (result & 0x100) != 0;
-    cpu->P.V = ((~(cpu->A ^ val) & (cpu->A ^ (BYTE)(result)) & 0x80) != 0);
-    cpu->A = (BYTE)(result) & 0xFF;
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case ADC_ABSOLUTE:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = ((second_addr << 8) + first_addr) & 0xFFFF;
-    BYTE val = mem_read(addr);
-    WORD result = cpu->A + cpu->P.C + val;
-    cpu->P.C = (result & 0x100) != 0;
-    cpu->P.V = ((~(cpu->A ^ val) & (cpu->A ^ (BYTE)(result)) & 0x80) != 0);
-    cpu->A = (BYTE)(result) & 0xFF;
-    setZN(cpu, cpu->A);
-    break;
   }
-  case ADC_ABSOLUTE_X:
+#else
+  if (have_watch)
   {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (((second_addr << 8) + first_addr) + cpu->X) & 0xFFFF;
-    BYTE val = mem_read(addr);
-    WORD result = cpu->A + cpu->P.C + val;
-    cpu->P.C = (result & 0x100) != 0;
-    cpu->P.V = ((~(cpu->A ^ val) & (cpu->A ^ (BYTE)(result)) & 0x80) != 0);
-    cpu->A = (BYTE)(result) & 0xFF;
-    setZN(cpu, cpu->A);
-    break;
+    fprintf(stderr, "%s: built without JOURNAL\n", argv[0]);
+    machine_destroy(m);
+    return 1;
   }
-  case ADC_ABSOLUTE_Y:
+#endif
+  StopReason reason;
+  if (gdb != NULL)
   {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (((second_addr << 8) + first_addr) + cpu->Y) & 0xFFFF;
-    BYTE val = mem_read(addr);
-    WORD result = cpu->A + cpu->P.C + val;
-    cpu->P.C = (result & 0x100) != 0;
-    cpu->P.V = ((~(cpu->A ^ val) & (cpu->A ^ (BYTE)(result)) & 0x80) != 0);
-    cpu->A = (BYTE)(result) & 0xFF;
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case ADC_INDIRECT_X:
-  {
-    BYTE ptr = mem_read(cpu->PC++);
-    BYTE addr_ptr = (BYTE)(ptr + cpu->X);
-    BYTE first_addr = mem_read(addr_ptr);
-    BYTE second_addr = mem_read((addr_ptr + 0x01) & 0xFF);
-    WORD addr = (second_addr << 8) | first_addr;
-    BYTE val = mem_read(addr);
-    WORD result = cpu->A + cpu->P.C + val;
-    cpu->P.C = (result & 0x100) != 0;
-    cpu->P.V = ((~(cpu->A ^ val) & (cpu->A ^ (BYTE)(result)) & 0x80) != 0);
-    cpu->A = (BYTE)(result) & 0xFF;
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case ADC_INDIRECT_Y:
-  {
-    BYTE addr_ptr = mem_read(cpu->PC++);
-    BYTE first_addr = mem_read(addr_ptr);
-    BYTE second_addr = mem_read((addr_ptr + 0x01) & 0xFF);
-    WORD addr = (second_addr << 8) | first_addr;
-    BYTE val = mem_read((addr + cpu->Y) & 0xFFFF);
-    WORD result = cpu->A + cpu->P.C + val;
-    cpu->P.C = (result & 0x100) != 0;
-    cpu->P.V = ((~(cpu->A ^ val) & (cpu->A ^ (BYTE)(result)) & 0x80) != 0);
-    cpu->A = (BYTE)(result) & 0xFF;
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case AND_IMMEDIATE:
-  {
-    cpu->A &= mem_read(cpu->PC++);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case AND_ZEROPAGE:
-  {
-    BYTE addr = mem_read(cpu->PC++);
-    cpu->A &= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case AND_ZEROPAGE_X:
-  {
-    BYTE base = mem_read(cpu->PC++);
-    BYTE addr = (BYTE)(base + cpu->X) & 0xFF;
-    cpu->A &= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case AND_ABSOLUTE:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    cpu->A &= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case AND_ABSOLUTE_X:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    addr = (addr + (WORD)cpu->X) & 0xFFFF;
-    cpu->A &= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case AND_ABSOLUTE_Y:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    addr = (addr + (WORD)cpu->Y) & 0xFFFF;
-    cpu->A &= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case AND_INDIRECT_X:
-  {
-    BYTE ptr = mem_read(cpu->PC++);
-    BYTE addr_ptr = (BYTE)(ptr + cpu->X);
-    BYTE first_addr = mem_read(addr_ptr);
-    BYTE second_addr = mem_read((addr_ptr + 0x01) & 0xFF);
-    WORD addr = (second_addr << 8) | first_addr;
-    cpu->A &= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case AND_INDIRECT_Y:
-  {
-    BYTE addr_ptr = mem_read(cpu->PC++);
-    BYTE first_addr = mem_read(addr_ptr);
-    BYTE second_addr = mem_read((addr_ptr + 0x01) & 0xFF);
-    WORD addr = (second_addr << 8) | first_addr;
-    cpu->A &= mem_read((addr + cpu->Y) & 0xFFFF);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case ORA_IMMEDIATE:
-  {
-    cpu->A |= mem_read(cpu->PC++);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case ORA_ZEROPAGE:
-  {
-    BYTE addr = mem_read(cpu->PC++);
-    cpu->A |= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case ORA_ZEROPAGE_X:
-  {
-    BYTE base = mem_read(cpu->PC++);
-    BYTE addr = (BYTE)(base + cpu->X) & 0xFF;
-    cpu->A |= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case ORA_ABSOLUTE:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    cpu->A |= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case ORA_ABSOLUTE_X:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    addr = (addr + (WORD)cpu->X) & 0xFFFF;
-    cpu->A |= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case ORA_ABSOLUTE_Y:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    addr = (addr + (WORD)cpu->Y) & 0xFFFF;
-    cpu->A |= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case ORA_INDIRECT_X:
-  {
-    BYTE ptr = mem_read(cpu->PC++);
-    BYTE addr_ptr = (BYTE)(ptr + cpu->X);
-    BYTE first_addr = mem_read(addr_ptr);
-    BYTE second_addr = mem_read((addr_ptr + 0x01) & 0xFF);
-    WORD addr = (second_addr << 8) | first_addr;
-    cpu->A |= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case ORA_INDIRECT_Y:
-  {
-    BYTE addr_ptr = mem_read(cpu->PC++);
-    BYTE first_addr = mem_read(addr_ptr);
-    BYTE second_addr = mem_read((addr_ptr + 0x01) & 0xFF);
-    WORD addr = (second_addr << 8) | first_addr;
-    cpu->A |= mem_read((addr + cpu->Y) & 0xFFFF);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case EOR_IMMEDIATE:
-  {
-    cpu->A ^= mem_read(cpu->PC++);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case EOR_ZEROPAGE:
-  {
-    BYTE addr = mem_read(cpu->PC++);
-    cpu->A ^= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case EOR_ZEROPAGE_X:
-  {
-    BYTE base = mem_read(cpu->PC++);
-    BYTE addr = (BYTE)(base + cpu->X) & 0xFF;
-    cpu->A ^= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case EOR_ABSOLUTE:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    cpu->A ^= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case EOR_ABSOLUTE_X:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    addr = (addr + (WORD)cpu->X) & 0xFFFF;
-    cpu->A ^= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case EOR_ABSOLUTE_Y:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (second_addr << 8) | first_addr;
-    addr = (addr + (WORD)cpu->Y) & 0xFFFF;
-    cpu->A ^= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case EOR_INDIRECT_X:
-  {
-    BYTE ptr = mem_read(cpu->PC++);
-    BYTE addr_ptr = (BYTE)(ptr + cpu->X);
-    BYTE first_addr = mem_read(addr_ptr);
-    BYTE second_addr = mem_read((addr_ptr + 0x01) & 0xFF);
-    WORD addr = (second_addr << 8) | first_addr;
-    cpu->A ^= mem_read(addr);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case EOR_INDIRECT_Y:
-  {
-    BYTE addr_ptr = mem_read(cpu->PC++);
-    BYTE first_addr = mem_read(addr_ptr);
-    BYTE second_addr = mem_read((addr_ptr + 0x01) & 0xFF);
-    WORD addr = (second_addr << 8) | first_addr;
-    cpu->A ^= mem_read((addr + cpu->Y) & 0xFFFF);
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case ASL_ACCUMULATOR:
-  {
-    cpu->P.C = (cpu->A & 0x80) != 0;
-    cpu->A = cpu->A << 1;
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case ASL_ZEROPAGE:
-  {
-    BYTE addr = mem_read(cpu->PC++);
-    BYTE val = mem_read(addr);
-    cpu->P.C = (val & 0x80) != 0;
-    val = val << 1;
-    mem_write(addr, val);
-    setZN(cpu, val);
-    break;
-  }
-  case ASL_ZEROPAGE_X:
-  {
-    BYTE addr = mem_read(cpu->PC++);
-    addr = (addr + cpu->X) & 0xFF;
-    BYTE val = mem_read(addr);
-    cpu->P.C = (val & 0x80) != 0;
-    val = val << 1;
-    mem_write(addr, val);
-    setZN(cpu, val);
-    break;
-  }
-  case ASL_ABSOLUTE:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = ((second_addr << 8) + first_addr) & 0xFFFF;
-    BYTE val = mem_read(addr);
-    cpu->P.C = (val & 0x80) != 0;
-    val = val << 1;
-    mem_write(addr, val);
-    setZN(cpu, val);
-    break;
-  }
-  case ASL_ABSOLUTE_X:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = (((second_addr << 8) + first_addr) + cpu->X) & 0xFFFF;
-    BYTE val = mem_read(addr);
-    cpu->P.C = (val & 0x80) != 0;
-    val = val << 1;
-    mem_write(addr, val);
-    setZN(cpu, val);
-    break;
-  }
-  case BIT_ZEROPAGE:
-  {
-    BYTE addr = mem_read(cpu->PC++);
-    BYTE val = mem_read(addr);
-    BYTE temp = val & cpu->A;
-    cpu->P.Z = (temp == 0);
-    cpu->P.N = (val & 0x80) != 0;
-    cpu->P.V = (val & 0x40) != 0;
-    break;
-  }
-  case BIT_ABSOLUTE:
-  {
-    BYTE first_addr = mem_read(cpu->PC++);
-    BYTE second_addr = mem_read(cpu->PC++);
-    WORD addr = ((second_addr << 8) + first_addr) & 0xFFFF;
-    BYTE val = mem_read(addr);
-    BYTE temp = val & cpu->A;
-    cpu->P.Z = (temp == 0);
-    cpu->P.N = (val & 0x80) != 0;
-    cpu->P.V = (val & 0x40) != 0;
-    break;
-  }
-  case DEX:
-  {
-    cpu->X = (cpu->X - 1) & 0xFF;
-    setZN(cpu, cpu->X);
-    break;
-  }
-  case DEY:
-  {
-    cpu->Y = (cpu->Y - 1) & 0xFF;
-    setZN(cpu, cpu->Y);
-    break;
-  }
-  case TAX:
-  {
-    cpu->X = cpu->A;
-    setZN(cpu, cpu->X);
-    break;
-  }
-  case TAY:
-  {
-    cpu->Y = cpu->A;
-    setZN(cpu, cpu->Y);
-    break;
-  }
-  case TSX:
-  {
-    cpu->X = cpu->S;
-    setZN(cpu, cpu->X);
-    break;
-  }
-  case TXA:
-  {
-    cpu->A = cpu->X;
-    setZN(cpu, cpu->A);
-    break;
-  }
-  case TXS:
-  {
-    cpu->S = cpu->X;
-    break;
-  }
-  case TYA:
-  {
-    cpu->A = cpu->Y;
-    setZN(cpu, cpu->Y);
-    break;
-  }
-  case CLC:
-  {
-    cpu->P.C = 0;
-    break;
+    fprintf(stderr, "Waiting for GDB on %s\n", gdb);
+    if (gdb_serve(m, gdb) != 0)
+    {
+      perror(gdb);
+    }
+    // A detach or kill leaves the machine wherever it was.
+    reason = STOP_BUDGET;
   }
-  case SEC:
+  else if (recording_path != NULL && !have_seek)
   {
-    cpu->P.C = 1;
-    break;
+    recording = recording_start(m, RECORDING_INTERVAL);
+    if (recording == NULL)
+    {
+      machine_destroy(m);
+      return 1;
+    }
+    reason = recording_run(recording, ULONG_MAX);
+    recording_stop(recording);
+    if (recording_save(recording, recording_path) != 0)
+    {
+      perror(recording_path);
+    }
   }
-  case SED:
+  else
   {
-    cpu->P.D = 1;
-    break;
+    // Per-instruction state goes to the trace now, trace_decode prints it.
+    reason = cpu_run(m, ULONG_MAX);
   }
-  case SEI:
+  recording_destroy(recording);
+  if (console != NULL)
   {
-    cpu->P.I = 1;
-    break;
+    machine_map_ram(m, console_address, console_address);
+    if (console_dropped(console) != 0)
+    {
+      fprintf(stderr, "console: %lu bytes dropped\n", console_dropped(console));
+    }
+    if (console_close(console) != 0)
+    {
+      fprintf(stderr, "console: could not write all output\n");
+    }
   }
-  case CLD:
+  Status p = cpu_status(cpu);
+  printf("A=%02X X=%02X Y=%02X Z=%d N=%d C=%d V=%d PC=%04X\n", cpu->A, cpu->X, cpu->Y, p.Z, p.N,
+         p.C, p.V, cpu->PC);
+#ifdef TRACE
+  if (m->trace != NULL && trace_close(m->trace) != 0)
   {
-    cpu->P.D = 0;
-    break;
+    fprintf(stderr, "%s: could not write the whole trace\n", trace_path);
   }
-  case CLI:
+#endif
+#ifdef PROFILE
+  if (m->profile != NULL)
   {
-    cpu->P.I = 0;
-    break;
+    profile_report(m->profile, m, stderr, 10);
+    profile_destroy(m->profile);
   }
-  case CLV:
+#endif
+  int status = 0;
+  if (reason == STOP_ILLEGAL)
   {
-    cpu->P.V = 0;
-    break;
+    printf("Opcode 0x%02x at PC=0x%04x\n", mem_read(m, cpu->PC), cpu->PC);
+    status = 1;
   }
-  case NOP:
+  else if (reason == STOP_BRK)
   {
-    printf("NOP\n");
-    break;
-  }
-  case BRK:
     printf("BRK\n");
-    exit(0);
-    break;
-  default:
-    printf("Opcode 0x%02x at PC=0x%04x\n", op_code, cpu->PC - 1);
-    exit(1);
-    break;
   }
-}
-int main()
-{
-  CPU cpu;
-  mem_write(0xFFFC, 0x00);
-  mem_write(0xFFFD, 0x80);
-  cpu_reset(&cpu);
-  printf("CPU reset complete. PC = 0x%04X, S = 0x%02X, U = %d, X = 0x%02X\n", cpu.PC, cpu.S,
-         cpu.P.U, cpu.X);
-
-  mem_write(0x8000, LDA_IMMEDIATE);
-  mem_write(0x8001, 0x10);
-  mem_write(0x8002, LDA_ZEROPAGE);
-  mem_write(0x8003, 0x20);
-  mem_write(0x8004, LDA_ZEROPAGE_X);
-  mem_write(0x8005, 0x1D);
-  mem_write(0x8006, LDA_ABSOLUTE);
-  mem_write(0x8007, 0x00);
-  mem_write(0x8008, 0x90);
-  mem_write(0x8009, LDA_ABSOLUTE_X);
-  mem_write(0x800A, 0x01);
-  mem_write(0x800B, 0x90);
-  mem_write(0x800C, LDA_ABSOLUTE_Y);
-  mem_write(0x800D, 0x02);
-  mem_write(0x800E, 0x90);
-  mem_write(0x800F, LDA_INDIRECT_X);
-  mem_write(0x8010, 0x30);
-  mem_write(0x8011, LDA_INDIRECT_Y);
-  mem_write(0x8012, 0x31);
-  // LDX
-  mem_write(0x8013, LDX_IMMEDIATE);
-  mem_write(0x8014, 0x03);
-  mem_write(0x8015, LDX_ZEROPAGE);
-  mem_write(0x8016, 0x21);
-  mem_write(0x8017, LDX_ZEROPAGE_Y);
-  mem_write(0x8018, 0x22);
-  mem_write(0x8019, LDX_ABSOLUTE);
-  mem_write(0x801A, 0x01);
-  mem_write(0x801B, 0x90);
-  mem_write(0x801C, LDX_ABSOLUTE_Y);
-  mem_write(0x801D, 0x02);
-  mem_write(0x801E, 0x90);
-
-  // LDY
-  mem_write(0x801F, LDY_IMMEDIATE);
-  mem_write(0x8020, 0x04);
-  mem_write(0x8021, LDY_ZEROPAGE);
-  mem_write(0x8022, 0x22);
-  mem_write(0x8023, LDY_ZEROPAGE_X);
-  mem_write(0x8024, 0x1E);
-  mem_write(0x8025, LDY_ABSOLUTE);
-  mem_write(0x8026, 0x02);
-  mem_write(0x8027, 0x90);
-  mem_write(0x8028, LDY_ABSOLUTE_X);
-  mem_write(0x8029, 0x01);
-  mem_write(0x802A, 0x90);
-
-  // STA/STX/STY
-  mem_write(0x802B, STA_ZEROPAGE);
-  mem_write(0x802C, 0x40);
-  mem_write(0x802D, STA_ZEROPAGE_X);
-  mem_write(0x802E, 0x41);
-  mem_write(0x802F, STA_ABSOLUTE);
-  mem_write(0x8030, 0x00);
-  mem_write(0x8031, 0x90);
-  mem_write(0x8032, STA_ABSOLUTE_X);
-  mem_write(0x8033, 0x01);
-  mem_write(0x8034, 0x90);
-  mem_write(0x8035, STA_ABSOLUTE_Y);
-  mem_write(0x8036, 0x02);
-  mem_write(0x8037, 0x90);
-  mem_write(0x8038, STA_INDIRECT_X);
-  mem_write(0x8039, 0x50);
-  mem_write(0x803A, STA_INDIRECT_Y);
-  mem_write(0x803B, 0x51);
-
-  mem_write(0x803C, STX_ZEROPAGE);
-  mem_write(0x803D, 0x42);
-  mem_write(0x803E, STX_ZEROPAGE_Y);
-  mem_write(0x803F, 0x43);
-  mem_write(0x8040, STX_ABSOLUTE);
-  mem_write(0x8041, 0x03);
-  mem_write(0x8042, 0x90);
-
-  mem_write(0x8043, STY_ZEROPAGE);
-  mem_write(0x8044, 0x44);
-  mem_write(0x8045, STY_ZEROPAGE_X);
-  mem_write(0x8046, 0x45);
-  mem_write(0x8047, STY_ABSOLUTE);
-  mem_write(0x8048, 0x04);
-  mem_write(0x8049, 0x90);
-
-  // Transfers
-  mem_write(0x804A, TAX);
-  mem_write(0x804B, TAY);
-  mem_write(0x804C, TSX);
-  mem_write(0x804D, TXA);
-  mem_write(0x804E, TXS);
-  mem_write(0x804F, TYA);
-
-  // INC/DEC
-  mem_write(0x8050, INC_ZEROPAGE);
-  mem_write(0x8051, 0x60);
-  mem_write(0x8052, INC_ZEROPAGE_X);
-  mem_write(0x8053, 0x61);
-  mem_write(0x8054, INC_ABSOLUTE);
-  mem_write(0x8055, 0x9000 & 0xFF);
-  mem_write(0x8056, 0x9000 >> 8);
-  mem_write(0x8057, INC_ABSOLUTE_X);
-  mem_write(0x8058, 0x9003 & 0xFF);
-  mem_write(0x8059, 0x9003 >> 8);
-
-  mem_write(0x805A, DEC_ZEROPAGE);
-  mem_write(0x805B, 0x62);
-  mem_write(0x805C, DEC_ZEROPAGE_X);
-  mem_write(0x805D, 0x63);
-  mem_write(0x805E, DEC_ABSOLUTE);
-  mem_write(0x805F, 0x9000 & 0xFF);
-  mem_write(0x8060, 0x9000 >> 8);
-  mem_write(0x8061, DEC_ABSOLUTE_X);
-  mem_write(0x8062, 0x9003 & 0xFF);
-  mem_write(0x8063, 0x9003 >> 8);
-
-  mem_write(0x8064, INX);
-  mem_write(0x8065, INY);
-
-  // ADC tests
-  mem_write(0x8066, ADC_IMMEDIATE);
-  mem_write(0x8067, 0x10);
-  mem_write(0x8068, ADC_ZEROPAGE);
-  mem_write(0x8069, 0x20);
-  mem_write(0x806A, ADC_ZEROPAGE_X);
-  mem_write(0x806B, 0x1D);
-  mem_write(0x806C, ADC_ABSOLUTE);
-  mem_write(0x806D, 0x00);
-  mem_write(0x806E, 0x90);
-  mem_write(0x806F, ADC_ABSOLUTE_X);
-  mem_write(0x8070, 0x01);
-  mem_write(0x8071, 0x90);
-  mem_write(0x8072, ADC_ABSOLUTE_Y);
-  mem_write(0x8073, 0x02);
-  mem_write(0x8074, 0x90);
-  mem_write(0x8075, ADC_INDIRECT_X);
-  mem_write(0x8076, 0x30);
-  mem_write(0x8077, ADC_INDIRECT_Y);
-  mem_write(0x8078, 0x31);
-
-  // AND tests
-  mem_write(0x8079, AND_IMMEDIATE);
-  mem_write(0x807A, 0x0F);
-  mem_write(0x807B, AND_ZEROPAGE);
-  mem_write(0x807C, 0x20);
-  mem_write(0x807D, AND_ZEROPAGE_X);
-  mem_write(0x807E, 0x1D);
-  mem_write(0x807F, AND_ABSOLUTE);
-  mem_write(0x8080, 0x00);
-  mem_write(0x8081, 0x90);
-  mem_write(0x8082, AND_ABSOLUTE_X);
-  mem_write(0x8083, 0x01);
-  mem_write(0x8084, 0x90);
-  mem_write(0x8085, AND_ABSOLUTE_Y);
-  mem_write(0x8086, 0x02);
-  mem_write(0x8087, 0x90);
-  mem_write(0x8088, AND_INDIRECT_X);
-  mem_write(0x8089, 0x30);
-  mem_write(0x808A, AND_INDIRECT_Y);
-  mem_write(0x808B, 0x31);
-
-  // Original Flag setup
-  mem_write(0x808C, CLC);
-  mem_write(0x808D, SEC);
-  mem_write(0x808E, SED);
-  mem_write(0x808F, SEI);
-
-  // --- NEWLY ADDED TESTS (ORA, EOR, BIT, ASL, DEGS, FLAGS) ---
-  // Starting at 0x8090
-
-  // ORA (Logical OR) Tests
-  mem_write(0x8090, ORA_IMMEDIATE);
-  mem_write(0x8091, 0x01);
-  mem_write(0x8092, ORA_ZEROPAGE);
-  mem_write(0x8093, 0x20);
-  mem_write(0x8094, ORA_ZEROPAGE_X);
-  mem_write(0x8095, 0x1D);
-  mem_write(0x8096, ORA_ABSOLUTE);
-  mem_write(0x8097, 0x00);
-  mem_write(0x8098, 0x90);
-  mem_write(0x8099, ORA_ABSOLUTE_X);
-  mem_write(0x809A, 0x01);
-  mem_write(0x809B, 0x90);
-  mem_write(0x809C, ORA_ABSOLUTE_Y);
-  mem_write(0x809D, 0x02);
-  mem_write(0x809E, 0x90);
-  mem_write(0x809F, ORA_INDIRECT_X);
-  mem_write(0x80A0, 0x30);
-  mem_write(0x80A1, ORA_INDIRECT_Y);
-  mem_write(0x80A2, 0x31);
-
-  // EOR (Exclusive OR) Tests
-  mem_write(0x80A3, EOR_IMMEDIATE);
-  mem_write(0x80A4, 0xFF);
-  mem_write(0x80A5, EOR_ZEROPAGE);
-  mem_write(0x80A6, 0x20);
-  mem_write(0x80A7, EOR_ZEROPAGE_X);
-  mem_write(0x80A8, 0x1D);
-  mem_write(0x80A9, EOR_ABSOLUTE);
-  mem_write(0x80AA, 0x00);
-  mem_write(0x80AB, 0x90);
-  mem_write(0x80AC, EOR_ABSOLUTE_X);
-  mem_write(0x80AD, 0x01);
-  mem_write(0x80AE, 0x90);
-  mem_write(0x80AF, EOR_ABSOLUTE_Y);
-  mem_write(0x80B0, 0x02);
-  mem_write(0x80B1, 0x90);
-  mem_write(0x80B2, EOR_INDIRECT_X);
-  mem_write(0x80B3, 0x30);
-  mem_write(0x80B4, EOR_INDIRECT_Y);
-  mem_write(0x80B5, 0x31);
-
-  // BIT Tests
-  mem_write(0x80B6, BIT_ZEROPAGE);
-  mem_write(0x80B7, 0x20);
-  mem_write(0x80B8, BIT_ABSOLUTE);
-  mem_write(0x80B9, 0x00);
-  mem_write(0x80BA, 0x90);
-
-  // ASL (Arithmetic Shift Left) Tests
-  mem_write(0x80BB, ASL_ACCUMULATOR);
-  mem_write(0x80BC, ASL_ZEROPAGE);
-  mem_write(0x80BD, 0x20);
-  mem_write(0x80BE, ASL_ZEROPAGE_X);
-  mem_write(0x80BF, 0x1D);
-  mem_write(0x80C0, ASL_ABSOLUTE);
-  mem_write(0x80C1, 0x00);
-  mem_write(0x80C2, 0x90);
-  mem_write(0x80C3, ASL_ABSOLUTE_X);
-  mem_write(0x80C4, 0x01);
-  mem_write(0x80C5, 0x90);
-
-  // DEX/DEY
-  mem_write(0x80C6, DEX);
-  mem_write(0x80C7, DEY);
-
-  // Flag Clears
-  mem_write(0x80C8, CLD);
-  mem_write(0x80C9, CLI);
-  mem_write(0x80CA, CLV);
-
-  mem_write(0x80CB, NOP);
-  mem_write(0x80CC, NOP);
-  mem_write(0x80CD, BRK);
-
-  mem_write(0x0020, 0xAA);
-  mem_write(0x0021, 0xBB);
-  mem_write(0x0022, 0xCC);
-  mem_write(0x0030, 0x01); // Indirect Pointer Low
-  mem_write(0x0031, 0x00); // Indirect Pointer High (Added for safety)
-  mem_write(0x0033, 0x05);
-
-  mem_write(0x9000, 0x11);
-  mem_write(0x9001, 0x22);
-  mem_write(0x9002, 0x33);
-  mem_write(0x9003, 0x44);
-  mem_write(0x9006, 0x66);
-  while (1)
+#ifdef JOURNAL
+  if (journal != NULL)
   {
-    execute(&cpu);
-    printf("A=%02X X=%02X Y=%02X Z=%d N=%d C=%d V=%d PC=%04X\n", cpu.A, cpu.X, cpu.Y, cpu.P.Z,
-           cpu.P.N, cpu.P.C, cpu.P.V, cpu.PC);
+    if (have_watch)
+    {
+      show_last_write(journal, m, watch);
+    }
+    journal_stop(journal);
   }
-  return 0;
+#endif
+  machine_destroy(m);
+  return status;
 }
@@ -0,0 +1,171 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "memmap.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "loader.h"
+#include "riot.h"
+#include "via.h"
+
+typedef struct
+{
+  const char* name;
+  // Maps the device over start..end, its interrupt output on the irq bit of
+  // the IRQ line. Returns 0 on success.
+  int (*attach)(Machine* m, WORD start, WORD end, unsigned irq);
+} DeviceType;
+
+// Devices from a map stay for as long as the machine does, nothing frees them.
+static int attach_via(Machine* m, WORD start, WORD end, unsigned irq)
+{
+  Via* v = via_create(m, irq);
+  if (v == NULL)
+  {
+    return -1;
+  }
+  via_map(v, start, end);
+  return 0;
+}
+
+static int attach_riot(Machine* m, WORD start, WORD end, unsigned irq)
+{
+  Riot* r = riot_create(m, irq);
+  if (r == NULL)
+  {
+    return -1;
+  }
+  riot_map(r, start, end);
+  return 0;
+}
+
+// Devices an "io" line can name. Ends with an empty entry.
+static const DeviceType devices[] = {
+    {"via", attach_via},
+    {"riot", attach_riot},
+    {NULL, NULL},
+};
+
+static int load_rom_image(Machine* m, WORD start, WORD end, const char* path)
+{
+  Image image;
+  if (image_load(m, path, start & 0xFF00, 1, &image) != 0)
+  {
+    return -1;
+  }
+  if (image.first < (start & 0xFF00) || image.last > (end | 0xFF))
+  {
+    fprintf(stderr, "%s: image does not fit in %04X-%04X\n", path, start & 0xFF00, end | 0xFF);
+    return -1;
+  }
+  return 0;
+}
+
+static int attach_device(Machine* m, WORD start, WORD end, const char* name, unsigned irq)
+{
+  for (const DeviceType* device = devices; device->name != NULL; device++)
+  {
+    if (strcmp(device->name, name) == 0)
+    {
+      if (device->attach(m, start, end, irq) != 0)
+      {
+        fprintf(stderr, "out of memory for '%s'\n", name);
+        return -1;
+      }
+      return 0;
+    }
+  }
+  fprintf(stderr, "unknown device '%s'\n", name);
+  return -1;
+}
+
+int memmap_load(Machine* m, const char* path)
+{
+  FILE* file = fopen(path, "r");
+  if (file == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+  char line[512];
+  int line_no = 0;
+  int result = 0;
+  // Every device gets a bit of its own on the IRQ line.
+  unsigned irq = 1;
+  while (result == 0 && fgets(line, sizeof line, file) != NULL)
+  {
+    line_no++;
+    char* comment = strchr(line, '#');
+    if (comment != NULL)
+    {
+      *comment = '\0';
+    }
+    char type[16];
+    char arg[256] = "";
+    unsigned start;
+    unsigned end;
+    int fields = sscanf(line, "%15s %x %x %255s", type, &start, &end, arg);
+    if (fields <= 0)
+    {
+      continue;
+    }
+    if (fields < 3 || start > 0xFFFF || end > 0xFFFF || start > end)
+    {
+      fprintf(stderr, "%s:%d: expected '<type> <start> <end>'\n", path, line_no);
+      result = -1;
+    }
+    else if (strcmp(type, "ram") == 0)
+    {
+      machine_map_ram(m, start, end);
+    }
+    else if (strcmp(type, "rom") == 0)
+    {
+      machine_map_rom(m, start, end, NULL);
+      if (fields == 4)
+      {
+        result = load_rom_image(m, start, end, arg);
+      }
+    }
+    else if (strcmp(type, "io") == 0)
+    {
+      if (fields < 4)
+      {
+        fprintf(stderr, "%s:%d: io region needs a device name\n", path, line_no);
+        result = -1;
+      }
+      else if (irq == 1u << MEMMAP_IRQ_BITS)
+      {
+        fprintf(stderr, "%s:%d: more than %d io devices\n", path, line_no, MEMMAP_IRQ_BITS);
+        result = -1;
+      }
+      else
+      {
+        result = attach_device(m, start, end, arg, irq);
+        irq <<= 1;
+      }
+    }
+    else
+    {
+      fprintf(stderr, "%s:%d: unknown region '%s'\n", path, line_no, type);
+      result = -1;
+    }
+  }
+  fclose(file);
+  return result;
+}
@@ -0,0 +1,41 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEMMAP_H
+#define MEMMAP_H
+
+#include "cpu.h"
+
+// IRQ bits a map hands out. The ones above are free for devices set up
+// outside it, like the console of emulator -c.
+#define MEMMAP_IRQ_BITS 31
+
+// Sets up the page table of m from a memory-map file. One region per line:
+//
+//   ram 0000 7FFF
+//   rom E000 FFFF kernal.bin
+//   io  D000 D0FF <device>
+//
+// Addresses are hex and get rounded out to whole pages. A ROM file goes through
+// image_load() at the start of its region and has to fit in it. Devices are
+// "via" (6522, see via.h) and "riot" (6532, see riot.h), each on a bit of the
+// IRQ line of its own, from bit 0 up to MEMMAP_IRQ_BITS - 1. '#' starts a
+// comment.
+// Returns 0 on success, otherwise prints what went wrong and returns -1.
+int memmap_load(Machine* m, const char* path);
+
+#endif
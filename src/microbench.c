@@ -0,0 +1,251 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// emulator_microbench: times a tight loop of every official opcode on its own
+// and prints host time and TSC ticks per emulated instruction as CSV, so a
+// slow handler shows up by name instead of hiding in a workload average.
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#include "cpu.h"
+#include "disasm.h"
+
+#define CODE_START 0x0200
+// Copies of the instruction per round of the loop.
+#define COPIES 64
+// Where memory operands point: zero page $80, absolute $3000, and the
+// pointer at $80 leads to $3000 too.
+#define ZP_ADDRESS 0x80
+#define ABS_ADDRESS 0x3000
+
+static void emit(Machine* m, WORD* pc, BYTE value)
+{
+  mem_write(m, (*pc)++, value);
+}
+
+// Sets S to top and X back to 0.
+static void emit_stack_setup(Machine* m, WORD* pc, BYTE top)
+{
+  emit(m, pc, LDX_IMMEDIATE);
+  emit(m, pc, top);
+  emit(m, pc, TXS);
+  emit(m, pc, LDX_IMMEDIATE);
+  emit(m, pc, 0x00);
+}
+
+// Lays out COPIES of op_code followed by a jump back to CODE_START. Control
+// flow and stack instructions get whatever they need to land on the next copy.
+static void build_loop(Machine* m, BYTE op_code)
+{
+  WORD pc = CODE_START;
+  mem_write(m, ZP_ADDRESS, ABS_ADDRESS & 0xFF);
+  mem_write(m, ZP_ADDRESS + 1, ABS_ADDRESS >> 8);
+  switch (op_code)
+  {
+  case BRK:
+    // One per round, the vector leads back to the start.
+    emit_stack_setup(m, &pc, 0xFF);
+    emit(m, &pc, BRK);
+    emit(m, &pc, 0x00);
+    mem_write(m, 0xFFFE, CODE_START & 0xFF);
+    mem_write(m, 0xFFFF, CODE_START >> 8);
+    break;
+  case RTS:
+  case RTI:
+  {
+    // Every copy pulls the address of the next one off a prepared stack.
+    int frame = op_code == RTS ? 2 : 3;
+    BYTE top = 0xFF - COPIES * frame;
+    emit_stack_setup(m, &pc, top);
+    for (int i = 0; i < COPIES; i++)
+    {
+      WORD next = pc + 1;
+      WORD slot = 0x0100 + top + 1 + i * frame;
+      if (op_code == RTS)
+      {
+        next--;
+      }
+      else
+      {
+        mem_write(m, slot++, 0x20);
+      }
+      mem_write(m, slot, next & 0xFF);
+      mem_write(m, slot + 1, next >> 8);
+      emit(m, &pc, op_code);
+    }
+    break;
+  }
+  default:
+    for (int i = 0; i < COPIES; i++)
+    {
+      WORD next = pc + instruction_length[op_code];
+      WORD operand = ABS_ADDRESS;
+      switch (addressing_mode[op_code])
+      {
+      case MODE_IMMEDIATE:
+        operand = 0x55;
+        break;
+      case MODE_ZEROPAGE:
+      case MODE_ZEROPAGE_X:
+      case MODE_ZEROPAGE_Y:
+      case MODE_INDIRECT_X:
+      case MODE_INDIRECT_Y:
+        operand = ZP_ADDRESS;
+        break;
+      case MODE_RELATIVE:
+        // Taken or not, it ends up at the next copy.
+        operand = 0x00;
+        break;
+      case MODE_INDIRECT:
+        operand = ABS_ADDRESS + 2 * i;
+        mem_write(m, operand, next & 0xFF);
+        mem_write(m, operand + 1, next >> 8);
+        break;
+      }
+      if (op_code == JMP_ABSOLUTE || op_code == JSR)
+      {
+        operand = next;
+      }
+      emit(m, &pc, op_code);
+      if (instruction_length[op_code] > 1)
+      {
+        emit(m, &pc, operand & 0xFF);
+      }
+      if (instruction_length[op_code] > 2)
+      {
+        emit(m, &pc, operand >> 8);
+      }
+    }
+    break;
+  }
+  emit(m, &pc, JMP_ABSOLUTE);
+  emit(m, &pc, CODE_START & 0xFF);
+  emit(m, &pc, CODE_START >> 8);
+}
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long long ticks(void)
+{
+#ifdef HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static void usage(const char* name)
+{
+  fprintf(stderr, "usage: %s [-n instructions] [-r repeats] [name...]\n", name);
+}
+
+int main(int argc, char** argv)
+{
+  unsigned long budget = 2000000;
+  int repeats = 3;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:r:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'n':
+      budget = strtoul(optarg, NULL, 0);
+      break;
+    case 'r':
+      repeats = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (budget == 0 || repeats < 1)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+  printf("opcode,instruction,instructions,ns_per_insn,tsc_per_insn\n");
+  for (int op_code = 0; op_code < 256; op_code++)
+  {
+    const char* name = opcode_name[op_code];
+    if (strcmp(name, "???") == 0)
+    {
+      continue;
+    }
+    // Names on the command line pick a subset.
+    int wanted = optind == argc;
+    for (int i = optind; i < argc && !wanted; i++)
+    {
+      wanted = strcmp(argv[i], name) == 0;
+    }
+    if (!wanted)
+    {
+      continue;
+    }
+    Machine* m = machine_create();
+    if (m == NULL)
+    {
+      return 1;
+    }
+    m->brk_interrupt = 1;
+    build_loop(m, op_code);
+    m->cpu.PC = CODE_START;
+    m->cpu.S = 0xFF;
+    // Best of a few runs, after one to warm up the caches.
+    cpu_run(m, budget);
+    double best_seconds = 0;
+    unsigned long long best_ticks = 0;
+    unsigned long long executed = 0;
+    for (int i = 0; i < repeats; i++)
+    {
+      unsigned long long before = m->instructions;
+      double start = now();
+      unsigned long long start_ticks = ticks();
+      cpu_run(m, budget);
+      unsigned long long spent_ticks = ticks() - start_ticks;
+      double seconds = now() - start;
+      if (i == 0 || seconds < best_seconds)
+      {
+        best_seconds = seconds;
+        best_ticks = spent_ticks;
+        executed = m->instructions - before;
+      }
+    }
+#ifdef HAVE_TSC
+    printf("%02X,%s,%llu,%.3f,%.2f\n", op_code, name, executed, best_seconds * 1e9 / executed,
+           (double)best_ticks / executed);
+#else
+    printf("%02X,%s,%llu,%.3f,\n", op_code, name, executed, best_seconds * 1e9 / executed);
+#endif
+    machine_destroy(m);
+  }
+  return 0;
+}
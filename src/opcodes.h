@@ -0,0 +1,250 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPCODES_H
+#define OPCODES_H
+
+// The NMOS 6502 opcode map, in opcode order. Each official opcode is
+//
+//   X(name, code, mnemonic, mode, bytes, cycles, penalty, flags)
+//
+// name is its constant in cpu.h, mode one of the MODE_ suffixes in disasm.h,
+// cycles the count without penalties and penalty the most it can add on top
+// (1 for an indexed read crossing a page, 2 for a branch taken into another
+// page). flags are the ones it can change. Every other opcode is U(code).
+//
+// The opcode constants, the length, cycle and disassembler tables and the
+// handlers in execute() are all generated from this.
+#define OPCODE_TABLE(X, U)                                                                         \
+  X(BRK, 0x00, BRK, IMPLIED, 2, 7, 0, "I")                                                         \
+  X(ORA_INDIRECT_X, 0x01, ORA, INDIRECT_X, 2, 6, 0, "NZ")                                          \
+  U(0x02) U(0x03) U(0x04)                                                                          \
+  X(ORA_ZEROPAGE, 0x05, ORA, ZEROPAGE, 2, 3, 0, "NZ")                                              \
+  X(ASL_ZEROPAGE, 0x06, ASL, ZEROPAGE, 2, 5, 0, "NZC")                                             \
+  U(0x07)                                                                                          \
+  X(PHP, 0x08, PHP, IMPLIED, 1, 3, 0, "-")                                                         \
+  X(ORA_IMMEDIATE, 0x09, ORA, IMMEDIATE, 2, 2, 0, "NZ")                                            \
+  X(ASL_ACCUMULATOR, 0x0A, ASL, ACCUMULATOR, 1, 2, 0, "NZC")                                       \
+  U(0x0B) U(0x0C)                                                                                  \
+  X(ORA_ABSOLUTE, 0x0D, ORA, ABSOLUTE, 3, 4, 0, "NZ")                                              \
+  X(ASL_ABSOLUTE, 0x0E, ASL, ABSOLUTE, 3, 6, 0, "NZC")                                             \
+  U(0x0F)                                                                                          \
+  X(BPL, 0x10, BPL, RELATIVE, 2, 2, 2, "-")                                                        \
+  X(ORA_INDIRECT_Y, 0x11, ORA, INDIRECT_Y, 2, 5, 1, "NZ")                                          \
+  U(0x12) U(0x13) U(0x14)                                                                          \
+  X(ORA_ZEROPAGE_X, 0x15, ORA, ZEROPAGE_X, 2, 4, 0, "NZ")                                          \
+  X(ASL_ZEROPAGE_X, 0x16, ASL, ZEROPAGE_X, 2, 6, 0, "NZC")                                         \
+  U(0x17)                                                                                          \
+  X(CLC, 0x18, CLC, IMPLIED, 1, 2, 0, "C")                                                         \
+  X(ORA_ABSOLUTE_Y, 0x19, ORA, ABSOLUTE_Y, 3, 4, 1, "NZ")                                          \
+  U(0x1A) U(0x1B) U(0x1C)                                                                          \
+  X(ORA_ABSOLUTE_X, 0x1D, ORA, ABSOLUTE_X, 3, 4, 1, "NZ")                                          \
+  X(ASL_ABSOLUTE_X, 0x1E, ASL, ABSOLUTE_X, 3, 7, 0, "NZC")                                         \
+  U(0x1F)                                                                                          \
+  X(JSR, 0x20, JSR, ABSOLUTE, 3, 6, 0, "-")                                                        \
+  X(AND_INDIRECT_X, 0x21, AND, INDIRECT_X, 2, 6, 0, "NZ")                                          \
+  U(0x22) U(0x23)                                                                                  \
+  X(BIT_ZEROPAGE, 0x24, BIT, ZEROPAGE, 2, 3, 0, "NVZ")                                             \
+  X(AND_ZEROPAGE, 0x25, AND, ZEROPAGE, 2, 3, 0, "NZ")                                              \
+  X(ROL_ZEROPAGE, 0x26, ROL, ZEROPAGE, 2, 5, 0, "NZC")                                             \
+  U(0x27)                                                                                          \
+  X(PLP, 0x28, PLP, IMPLIED, 1, 4, 0, "NVDIZC")                                                    \
+  X(AND_IMMEDIATE, 0x29, AND, IMMEDIATE, 2, 2, 0, "NZ")                                            \
+  X(ROL_ACCUMULATOR, 0x2A, ROL, ACCUMULATOR, 1, 2, 0, "NZC")                                       \
+  U(0x2B)                                                                                          \
+  X(BIT_ABSOLUTE, 0x2C, BIT, ABSOLUTE, 3, 4, 0, "NVZ")                                             \
+  X(AND_ABSOLUTE, 0x2D, AND, ABSOLUTE, 3, 4, 0, "NZ")                                              \
+  X(ROL_ABSOLUTE, 0x2E, ROL, ABSOLUTE, 3, 6, 0, "NZC")                                             \
+  U(0x2F)                                                                                          \
+  X(BMI, 0x30, BMI, RELATIVE, 2, 2, 2, "-")                                                        \
+  X(AND_INDIRECT_Y, 0x31, AND, INDIRECT_Y, 2, 5, 1, "NZ")                                          \
+  U(0x32) U(0x33) U(0x34)                                                                          \
+  X(AND_ZEROPAGE_X, 0x35, AND, ZEROPAGE_X, 2, 4, 0, "NZ")                                          \
+  X(ROL_ZEROPAGE_X, 0x36, ROL, ZEROPAGE_X, 2, 6, 0, "NZC")                                         \
+  U(0x37)                                                                                          \
+  X(SEC, 0x38, SEC, IMPLIED, 1, 2, 0, "C")                                                         \
+  X(AND_ABSOLUTE_Y, 0x39, AND, ABSOLUTE_Y, 3, 4, 1, "NZ")                                          \
+  U(0x3A) U(0x3B) U(0x3C)                                                                          \
+  X(AND_ABSOLUTE_X, 0x3D, AND, ABSOLUTE_X, 3, 4, 1, "NZ")                                          \
+  X(ROL_ABSOLUTE_X, 0x3E, ROL, ABSOLUTE_X, 3, 7, 0, "NZC")                                         \
+  U(0x3F)                                                                                          \
+  X(RTI, 0x40, RTI, IMPLIED, 1, 6, 0, "NVDIZC")                                                    \
+  X(EOR_INDIRECT_X, 0x41, EOR, INDIRECT_X, 2, 6, 0, "NZ")                                          \
+  U(0x42) U(0x43) U(0x44)                                                                          \
+  X(EOR_ZEROPAGE, 0x45, EOR, ZEROPAGE, 2, 3, 0, "NZ")                                              \
+  X(LSR_ZEROPAGE, 0x46, LSR, ZEROPAGE, 2, 5, 0, "NZC")                                             \
+  U(0x47)                                                                                          \
+  X(PHA, 0x48, PHA, IMPLIED, 1, 3, 0, "-")                                                         \
+  X(EOR_IMMEDIATE, 0x49, EOR, IMMEDIATE, 2, 2, 0, "NZ")                                            \
+  X(LSR_ACCUMULATOR, 0x4A, LSR, ACCUMULATOR, 1, 2, 0, "NZC")                                       \
+  U(0x4B)                                                                                          \
+  X(JMP_ABSOLUTE, 0x4C, JMP, ABSOLUTE, 3, 3, 0, "-")                                               \
+  X(EOR_ABSOLUTE, 0x4D, EOR, ABSOLUTE, 3, 4, 0, "NZ")                                              \
+  X(LSR_ABSOLUTE, 0x4E, LSR, ABSOLUTE, 3, 6, 0, "NZC")                                             \
+  U(0x4F)                                                                                          \
+  X(BVC, 0x50, BVC, RELATIVE, 2, 2, 2, "-")                                                        \
+  X(EOR_INDIRECT_Y, 0x51, EOR, INDIRECT_Y, 2, 5, 1, "NZ")                                          \
+  U(0x52) U(0x53) U(0x54)                                                                          \
+  X(EOR_ZEROPAGE_X, 0x55, EOR, ZEROPAGE_X, 2, 4, 0, "NZ")                                          \
+  X(LSR_ZEROPAGE_X, 0x56, LSR, ZEROPAGE_X, 2, 6, 0, "NZC")                                         \
+  U(0x57)                                                                                          \
+  X(CLI, 0x58, CLI, IMPLIED, 1, 2, 0, "I")                                                         \
+  X(EOR_ABSOLUTE_Y, 0x59, EOR, ABSOLUTE_Y, 3, 4, 1, "NZ")                                          \
+  U(0x5A) U(0x5B) U(0x5C)                                                                          \
+  X(EOR_ABSOLUTE_X, 0x5D, EOR, ABSOLUTE_X, 3, 4, 1, "NZ")                                          \
+  X(LSR_ABSOLUTE_X, 0x5E, LSR, ABSOLUTE_X, 3, 7, 0, "NZC")                                         \
+  U(0x5F)                                                                                          \
+  X(RTS, 0x60, RTS, IMPLIED, 1, 6, 0, "-")                                                         \
+  X(ADC_INDIRECT_X, 0x61, ADC, INDIRECT_X, 2, 6, 0, "NVZC")                                        \
+  U(0x62) U(0x63) U(0x64)                                                                          \
+  X(ADC_ZEROPAGE, 0x65, ADC, ZEROPAGE, 2, 3, 0, "NVZC")                                            \
+  X(ROR_ZEROPAGE, 0x66, ROR, ZEROPAGE, 2, 5, 0, "NZC")                                             \
+  U(0x67)                                                                                          \
+  X(PLA, 0x68, PLA, IMPLIED, 1, 4, 0, "NZ")                                                        \
+  X(ADC_IMMEDIATE, 0x69, ADC, IMMEDIATE, 2, 2, 0, "NVZC")                                          \
+  X(ROR_ACCUMULATOR, 0x6A, ROR, ACCUMULATOR, 1, 2, 0, "NZC")                                       \
+  U(0x6B)                                                                                          \
+  X(JMP_INDIRECT, 0x6C, JMP, INDIRECT, 3, 5, 0, "-")                                               \
+  X(ADC_ABSOLUTE, 0x6D, ADC, ABSOLUTE, 3, 4, 0, "NVZC")                                            \
+  X(ROR_ABSOLUTE, 0x6E, ROR, ABSOLUTE, 3, 6, 0, "NZC")                                             \
+  U(0x6F)                                                                                          \
+  X(BVS, 0x70, BVS, RELATIVE, 2, 2, 2, "-")                                                        \
+  X(ADC_INDIRECT_Y, 0x71, ADC, INDIRECT_Y, 2, 5, 1, "NVZC")                                        \
+  U(0x72) U(0x73) U(0x74)                                                                          \
+  X(ADC_ZEROPAGE_X, 0x75, ADC, ZEROPAGE_X, 2, 4, 0, "NVZC")                                        \
+  X(ROR_ZEROPAGE_X, 0x76, ROR, ZEROPAGE_X, 2, 6, 0, "NZC")                                         \
+  U(0x77)                                                                                          \
+  X(SEI, 0x78, SEI, IMPLIED, 1, 2, 0, "I")                                                         \
+  X(ADC_ABSOLUTE_Y, 0x79, ADC, ABSOLUTE_Y, 3, 4, 1, "NVZC")                                        \
+  U(0x7A) U(0x7B) U(0x7C)                                                                          \
+  X(ADC_ABSOLUTE_X, 0x7D, ADC, ABSOLUTE_X, 3, 4, 1, "NVZC")                                        \
+  X(ROR_ABSOLUTE_X, 0x7E, ROR, ABSOLUTE_X, 3, 7, 0, "NZC")                                         \
+  U(0x7F) U(0x80)                                                                                  \
+  X(STA_INDIRECT_X, 0x81, STA, INDIRECT_X, 2, 6, 0, "-")                                           \
+  U(0x82) U(0x83)                                                                                  \
+  X(STY_ZEROPAGE, 0x84, STY, ZEROPAGE, 2, 3, 0, "-")                                               \
+  X(STA_ZEROPAGE, 0x85, STA, ZEROPAGE, 2, 3, 0, "-")                                               \
+  X(STX_ZEROPAGE, 0x86, STX, ZEROPAGE, 2, 3, 0, "-")                                               \
+  U(0x87)                                                                                          \
+  X(DEY, 0x88, DEY, IMPLIED, 1, 2, 0, "NZ")                                                        \
+  U(0x89)                                                                                          \
+  X(TXA, 0x8A, TXA, IMPLIED, 1, 2, 0, "NZ")                                                        \
+  U(0x8B)                                                                                          \
+  X(STY_ABSOLUTE, 0x8C, STY, ABSOLUTE, 3, 4, 0, "-")                                               \
+  X(STA_ABSOLUTE, 0x8D, STA, ABSOLUTE, 3, 4, 0, "-")                                               \
+  X(STX_ABSOLUTE, 0x8E, STX, ABSOLUTE, 3, 4, 0, "-")                                               \
+  U(0x8F)                                                                                          \
+  X(BCC, 0x90, BCC, RELATIVE, 2, 2, 2, "-")                                                        \
+  X(STA_INDIRECT_Y, 0x91, STA, INDIRECT_Y, 2, 6, 0, "-")                                           \
+  U(0x92) U(0x93)                                                                                  \
+  X(STY_ZEROPAGE_X, 0x94, STY, ZEROPAGE_X, 2, 4, 0, "-")                                           \
+  X(STA_ZEROPAGE_X, 0x95, STA, ZEROPAGE_X, 2, 4, 0, "-")                                           \
+  X(STX_ZEROPAGE_Y, 0x96, STX, ZEROPAGE_Y, 2, 4, 0, "-")                                           \
+  U(0x97)                                                                                          \
+  X(TYA, 0x98, TYA, IMPLIED, 1, 2, 0, "NZ")                                                        \
+  X(STA_ABSOLUTE_Y, 0x99, STA, ABSOLUTE_Y, 3, 5, 0, "-")                                           \
+  X(TXS, 0x9A, TXS, IMPLIED, 1, 2, 0, "-")                                                         \
+  U(0x9B) U(0x9C)                                                                                  \
+  X(STA_ABSOLUTE_X, 0x9D, STA, ABSOLUTE_X, 3, 5, 0, "-")                                           \
+  U(0x9E) U(0x9F)                                                                                  \
+  X(LDY_IMMEDIATE, 0xA0, LDY, IMMEDIATE, 2, 2, 0, "NZ")                                            \
+  X(LDA_INDIRECT_X, 0xA1, LDA, INDIRECT_X, 2, 6, 0, "NZ")                                          \
+  X(LDX_IMMEDIATE, 0xA2, LDX, IMMEDIATE, 2, 2, 0, "NZ")                                            \
+  U(0xA3)                                                                                          \
+  X(LDY_ZEROPAGE, 0xA4, LDY, ZEROPAGE, 2, 3, 0, "NZ")                                              \
+  X(LDA_ZEROPAGE, 0xA5, LDA, ZEROPAGE, 2, 3, 0, "NZ")                                              \
+  X(LDX_ZEROPAGE, 0xA6, LDX, ZEROPAGE, 2, 3, 0, "NZ")                                              \
+  U(0xA7)                                                                                          \
+  X(TAY, 0xA8, TAY, IMPLIED, 1, 2, 0, "NZ")                                                        \
+  X(LDA_IMMEDIATE, 0xA9, LDA, IMMEDIATE, 2, 2, 0, "NZ")                                            \
+  X(TAX, 0xAA, TAX, IMPLIED, 1, 2, 0, "NZ")                                                        \
+  U(0xAB)                                                                                          \
+  X(LDY_ABSOLUTE, 0xAC, LDY, ABSOLUTE, 3, 4, 0, "NZ")                                              \
+  X(LDA_ABSOLUTE, 0xAD, LDA, ABSOLUTE, 3, 4, 0, "NZ")                                              \
+  X(LDX_ABSOLUTE, 0xAE, LDX, ABSOLUTE, 3, 4, 0, "NZ")                                              \
+  U(0xAF)                                                                                          \
+  X(BCS, 0xB0, BCS, RELATIVE, 2, 2, 2, "-")                                                        \
+  X(LDA_INDIRECT_Y, 0xB1, LDA, INDIRECT_Y, 2, 5, 1, "NZ")                                          \
+  U(0xB2) U(0xB3)                                                                                  \
+  X(LDY_ZEROPAGE_X, 0xB4, LDY, ZEROPAGE_X, 2, 4, 0, "NZ")                                          \
+  X(LDA_ZEROPAGE_X, 0xB5, LDA, ZEROPAGE_X, 2, 4, 0, "NZ")                                          \
+  X(LDX_ZEROPAGE_Y, 0xB6, LDX, ZEROPAGE_Y, 2, 4, 0, "NZ")                                          \
+  U(0xB7)                                                                                          \
+  X(CLV, 0xB8, CLV, IMPLIED, 1, 2, 0, "V")                                                         \
+  X(LDA_ABSOLUTE_Y, 0xB9, LDA, ABSOLUTE_Y, 3, 4, 1, "NZ")                                          \
+  X(TSX, 0xBA, TSX, IMPLIED, 1, 2, 0, "NZ")                                                        \
+  U(0xBB)                                                                                          \
+  X(LDY_ABSOLUTE_X, 0xBC, LDY, ABSOLUTE_X, 3, 4, 1, "NZ")                                          \
+  X(LDA_ABSOLUTE_X, 0xBD, LDA, ABSOLUTE_X, 3, 4, 1, "NZ")                                          \
+  X(LDX_ABSOLUTE_Y, 0xBE, LDX, ABSOLUTE_Y, 3, 4, 1, "NZ")                                          \
+  U(0xBF)                                                                                          \
+  X(CPY_IMMEDIATE, 0xC0, CPY, IMMEDIATE, 2, 2, 0, "NZC")                                           \
+  X(CMP_INDIRECT_X, 0xC1, CMP, INDIRECT_X, 2, 6, 0, "NZC")                                         \
+  U(0xC2) U(0xC3)                                                                                  \
+  X(CPY_ZEROPAGE, 0xC4, CPY, ZEROPAGE, 2, 3, 0, "NZC")                                             \
+  X(CMP_ZEROPAGE, 0xC5, CMP, ZEROPAGE, 2, 3, 0, "NZC")                                             \
+  X(DEC_ZEROPAGE, 0xC6, DEC, ZEROPAGE, 2, 5, 0, "NZ")                                              \
+  U(0xC7)                                                                                          \
+  X(INY, 0xC8, INY, IMPLIED, 1, 2, 0, "NZ")                                                        \
+  X(CMP_IMMEDIATE, 0xC9, CMP, IMMEDIATE, 2, 2, 0, "NZC")                                           \
+  X(DEX, 0xCA, DEX, IMPLIED, 1, 2, 0, "NZ")                                                        \
+  U(0xCB)                                                                                          \
+  X(CPY_ABSOLUTE, 0xCC, CPY, ABSOLUTE, 3, 4, 0, "NZC")                                             \
+  X(CMP_ABSOLUTE, 0xCD, CMP, ABSOLUTE, 3, 4, 0, "NZC")                                             \
+  X(DEC_ABSOLUTE, 0xCE, DEC, ABSOLUTE, 3, 6, 0, "NZ")                                              \
+  U(0xCF)                                                                                          \
+  X(BNE, 0xD0, BNE, RELATIVE, 2, 2, 2, "-")                                                        \
+  X(CMP_INDIRECT_Y, 0xD1, CMP, INDIRECT_Y, 2, 5, 1, "NZC")                                         \
+  U(0xD2) U(0xD3) U(0xD4)                                                                          \
+  X(CMP_ZEROPAGE_X, 0xD5, CMP, ZEROPAGE_X, 2, 4, 0, "NZC")                                         \
+  X(DEC_ZEROPAGE_X, 0xD6, DEC, ZEROPAGE_X, 2, 6, 0, "NZ")                                          \
+  U(0xD7)                                                                                          \
+  X(CLD, 0xD8, CLD, IMPLIED, 1, 2, 0, "D")                                                         \
+  X(CMP_ABSOLUTE_Y, 0xD9, CMP, ABSOLUTE_Y, 3, 4, 1, "NZC")                                         \
+  U(0xDA) U(0xDB) U(0xDC)                                                                          \
+  X(CMP_ABSOLUTE_X, 0xDD, CMP, ABSOLUTE_X, 3, 4, 1, "NZC")                                         \
+  X(DEC_ABSOLUTE_X, 0xDE, DEC, ABSOLUTE_X, 3, 7, 0, "NZ")                                          \
+  U(0xDF)                                                                                          \
+  X(CPX_IMMEDIATE, 0xE0, CPX, IMMEDIATE, 2, 2, 0, "NZC")                                           \
+  X(SBC_INDIRECT_X, 0xE1, SBC, INDIRECT_X, 2, 6, 0, "NVZC")                                        \
+  U(0xE2) U(0xE3)                                                                                  \
+  X(CPX_ZEROPAGE, 0xE4, CPX, ZEROPAGE, 2, 3, 0, "NZC")                                             \
+  X(SBC_ZEROPAGE, 0xE5, SBC, ZEROPAGE, 2, 3, 0, "NVZC")                                            \
+  X(INC_ZEROPAGE, 0xE6, INC, ZEROPAGE, 2, 5, 0, "NZ")                                              \
+  U(0xE7)                                                                                          \
+  X(INX, 0xE8, INX, IMPLIED, 1, 2, 0, "NZ")                                                        \
+  X(SBC_IMMEDIATE, 0xE9, SBC, IMMEDIATE, 2, 2, 0, "NVZC")                                          \
+  X(NOP, 0xEA, NOP, IMPLIED, 1, 2, 0, "-")                                                         \
+  U(0xEB)                                                                                          \
+  X(CPX_ABSOLUTE, 0xEC, CPX, ABSOLUTE, 3, 4, 0, "NZC")                                             \
+  X(SBC_ABSOLUTE, 0xED, SBC, ABSOLUTE, 3, 4, 0, "NVZC")                                            \
+  X(INC_ABSOLUTE, 0xEE, INC, ABSOLUTE, 3, 6, 0, "NZ")                                              \
+  U(0xEF)                                                                                          \
+  X(BEQ, 0xF0, BEQ, RELATIVE, 2, 2, 2, "-")                                                        \
+  X(SBC_INDIRECT_Y, 0xF1, SBC, INDIRECT_Y, 2, 5, 1, "NVZC")                                        \
+  U(0xF2) U(0xF3) U(0xF4)                                                                          \
+  X(SBC_ZEROPAGE_X, 0xF5, SBC, ZEROPAGE_X, 2, 4, 0, "NVZC")                                        \
+  X(INC_ZEROPAGE_X, 0xF6, INC, ZEROPAGE_X, 2, 6, 0, "NZ")                                          \
+  U(0xF7)                                                                                          \
+  X(SED, 0xF8, SED, IMPLIED, 1, 2, 0, "D")                                                         \
+  X(SBC_ABSOLUTE_Y, 0xF9, SBC, ABSOLUTE_Y, 3, 4, 1, "NVZC")                                        \
+  U(0xFA) U(0xFB) U(0xFC)                                                                          \
+  X(SBC_ABSOLUTE_X, 0xFD, SBC, ABSOLUTE_X, 3, 4, 1, "NVZC")                                        \
+  X(INC_ABSOLUTE_X, 0xFE, INC, ABSOLUTE_X, 3, 7, 0, "NZ")                                          \
+  U(0xFF)
+
+#endif
@@ -0,0 +1,584 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// processor_tests: runs single-instruction test vectors in the ProcessorTests
+// JSON format (https://github.com/SingleStepTests/65x02, directory 6502/v1)
+// against cpu_run(). Every file is an array of
+//
+//   {"name": "a9 2e 8f",
+//    "initial": {"pc": 1234, "s": 253, "a": 0, "x": 0, "y": 0, "p": 36,
+//                "ram": [[1234, 169], [1235, 46]]},
+//    "final": {...},
+//    "cycles": [[1234, 169, "read"], ...]}
+//
+// Files are handed out to one thread per core, each with its own Machine.
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cpu.h"
+#include "disasm.h"
+
+// The vectors touch a handful of addresses each, this is plenty.
+#define MAX_RAM 64
+// B and U are not real flags, the files disagree with PHP/BRK about them.
+#define FLAG_MASK 0xCF
+
+typedef struct
+{
+  WORD pc;
+  BYTE s, a, x, y, p;
+  int ram_count;
+  WORD address[MAX_RAM];
+  BYTE value[MAX_RAM];
+} State;
+
+typedef struct
+{
+  char name[32];
+  State initial;
+  State final;
+  int cycles;
+} Vector;
+
+// A cursor over a whole file. Any syntax error sets error and makes every
+// later call a no-op, so callers check once per vector.
+typedef struct
+{
+  const char* p;
+  const char* end;
+  int error;
+} Parser;
+
+static char** files;
+static int file_count;
+static atomic_int next_file;
+static atomic_ulong vector_count;
+static atomic_ulong failure_count;
+static atomic_int printed;
+static int max_printed = 20;
+static pthread_mutex_t print_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void skip_space(Parser* ps)
+{
+  while (ps->p < ps->end && (*ps->p == ' ' || *ps->p == '\n' || *ps->p == '\r' || *ps->p == '\t'))
+  {
+    ps->p++;
+  }
+}
+
+// Consumes c if it is next.
+static int accept(Parser* ps, char c)
+{
+  skip_space(ps);
+  if (ps->p < ps->end && *ps->p == c)
+  {
+    ps->p++;
+    return 1;
+  }
+  return 0;
+}
+
+static void expect(Parser* ps, char c)
+{
+  if (!accept(ps, c))
+  {
+    ps->error = 1;
+    ps->p = ps->end;
+  }
+}
+
+static long parse_number(Parser* ps)
+{
+  skip_space(ps);
+  long value = 0;
+  int digits = 0;
+  while (ps->p < ps->end && *ps->p >= '0' && *ps->p <= '9')
+  {
+    value = value * 10 + (*ps->p++ - '0');
+    digits++;
+  }
+  if (digits == 0)
+  {
+    expect(ps, '0');
+  }
+  return value;
+}
+
+// Copies the string, truncated to size - 1.
+static void parse_string(Parser* ps, char* buf, size_t size)
+{
+  size_t n = 0;
+  expect(ps, '"');
+  while (ps->p < ps->end && *ps->p != '"')
+  {
+    if (*ps->p == '\\')
+    {
+      ps->p++;
+    }
+    if (n + 1 < size)
+    {
+      buf[n++] = *ps->p;
+    }
+    ps->p++;
+  }
+  buf[n] = '\0';
+  expect(ps, '"');
+}
+
+static void skip_value(Parser* ps)
+{
+  char scratch[2];
+  skip_space(ps);
+  if (ps->p >= ps->end)
+  {
+    ps->error = 1;
+  }
+  else if (*ps->p == '"')
+  {
+    parse_string(ps, scratch, sizeof scratch);
+  }
+  else if (accept(ps, '['))
+  {
+    if (!accept(ps, ']'))
+    {
+      do
+      {
+        skip_value(ps);
+      } while (accept(ps, ','));
+      expect(ps, ']');
+    }
+  }
+  else if (accept(ps, '{'))
+  {
+    if (!accept(ps, '}'))
+    {
+      do
+      {
+        parse_string(ps, scratch, sizeof scratch);
+        expect(ps, ':');
+        skip_value(ps);
+      } while (accept(ps, ','));
+      expect(ps, '}');
+    }
+  }
+  else if (*ps->p == '-')
+  {
+    ps->p++;
+    parse_number(ps);
+  }
+  else if (*ps->p >= '0' && *ps->p <= '9')
+  {
+    parse_number(ps);
+  }
+  else
+  {
+    // true, false or null.
+    while (ps->p < ps->end && *ps->p >= 'a' && *ps->p <= 'z')
+    {
+      ps->p++;
+    }
+  }
+}
+
+static void parse_state(Parser* ps, State* state)
+{
+  char key[8];
+  expect(ps, '{');
+  state->ram_count = 0;
+  do
+  {
+    parse_string(ps, key, sizeof key);
+    expect(ps, ':');
+    if (strcmp(key, "pc") == 0)
+    {
+      state->pc = parse_number(ps);
+    }
+    else if (strcmp(key, "s") == 0)
+    {
+      state->s = parse_number(ps);
+    }
+    else if (strcmp(key, "a") == 0)
+    {
+      state->a = parse_number(ps);
+    }
+    else if (strcmp(key, "x") == 0)
+    {
+      state->x = parse_number(ps);
+    }
+    else if (strcmp(key, "y") == 0)
+    {
+      state->y = parse_number(ps);
+    }
+    else if (strcmp(key, "p") == 0)
+    {
+      state->p = parse_number(ps);
+    }
+    else if (strcmp(key, "ram") == 0)
+    {
+      expect(ps, '[');
+      if (!accept(ps, ']'))
+      {
+        do
+        {
+          expect(ps, '[');
+          WORD address = parse_number(ps);
+          expect(ps, ',');
+          BYTE value = parse_number(ps);
+          expect(ps, ']');
+          if (state->ram_count == MAX_RAM)
+          {
+            ps->error = 1;
+            return;
+          }
+          state->address[state->ram_count] = address;
+          state->value[state->ram_count++] = value;
+        } while (accept(ps, ','));
+        expect(ps, ']');
+      }
+    }
+    else
+    {
+      skip_value(ps);
+    }
+  } while (accept(ps, ','));
+  expect(ps, '}');
+}
+
+// Reads the vector after the cursor, which sits just past '[' or ','.
+static void parse_vector(Parser* ps, Vector* v)
+{
+  char key[16];
+  v->name[0] = '\0';
+  v->cycles = -1;
+  expect(ps, '{');
+  do
+  {
+    parse_string(ps, key, sizeof key);
+    expect(ps, ':');
+    if (strcmp(key, "name") == 0)
+    {
+      parse_string(ps, v->name, sizeof v->name);
+    }
+    else if (strcmp(key, "initial") == 0)
+    {
+      parse_state(ps, &v->initial);
+    }
+    else if (strcmp(key, "final") == 0)
+    {
+      parse_state(ps, &v->final);
+    }
+    else if (strcmp(key, "cycles") == 0)
+    {
+      // One entry per bus cycle.
+      v->cycles = 0;
+      expect(ps, '[');
+      if (!accept(ps, ']'))
+      {
+        do
+        {
+          skip_value(ps);
+          v->cycles++;
+        } while (accept(ps, ','));
+        expect(ps, ']');
+      }
+    }
+    else
+    {
+      skip_value(ps);
+    }
+  } while (accept(ps, ','));
+  expect(ps, '}');
+}
+
+// Appends "what got, want" to the diff when they differ.
+static int diff(char* buf, size_t size, size_t* used, const char* what, int got, int want)
+{
+  if (got == want)
+  {
+    return 0;
+  }
+  if (*used < size)
+  {
+    *used += snprintf(buf + *used, size - *used, " %s=%02X want %02X", what, got, want);
+  }
+  return 1;
+}
+
+// Runs one vector on m and prints what differs. Returns 0 when it passes.
+static int run_vector(Machine* m, const char* file, const Vector* v)
+{
+  const State* in = &v->initial;
+  const State* out = &v->final;
+  for (int i = 0; i < in->ram_count; i++)
+  {
+    mem_write(m, in->address[i], in->value[i]);
+  }
+  CPU* cpu = &m->cpu;
+  cpu->PC = in->pc;
+  cpu->S = in->s;
+  cpu->A = in->a;
+  cpu->X = in->x;
+  cpu->Y = in->y;
+  cpu_set_status_byte(cpu, in->p);
+  unsigned long long start = m->cycles;
+  StopReason reason = cpu_run(m, 1);
+
+  char buf[512];
+  size_t used = 0;
+  int bad = 0;
+  bad |= diff(buf, sizeof buf, &used, "stop", reason, STOP_BUDGET);
+  bad |= diff(buf, sizeof buf, &used, "PCH", cpu->PC >> 8, out->pc >> 8);
+  bad |= diff(buf, sizeof buf, &used, "PCL", cpu->PC & 0xFF, out->pc & 0xFF);
+  bad |= diff(buf, sizeof buf, &used, "S", cpu->S, out->s);
+  bad |= diff(buf, sizeof buf, &used, "A", cpu->A, out->a);
+  bad |= diff(buf, sizeof buf, &used, "X", cpu->X, out->x);
+  bad |= diff(buf, sizeof buf, &used, "Y", cpu->Y, out->y);
+  bad |= diff(buf, sizeof buf, &used, "P", cpu_status_byte(cpu) & FLAG_MASK, out->p & FLAG_MASK);
+  for (int i = 0; i < out->ram_count; i++)
+  {
+    char what[8];
+    snprintf(what, sizeof what, "$%04X", out->address[i]);
+    bad |= diff(buf, sizeof buf, &used, what, m->memory[out->address[i]], out->value[i]);
+  }
+  if (v->cycles >= 0)
+  {
+    bad |= diff(buf, sizeof buf, &used, "cycles", (int)(m->cycles - start), v->cycles);
+  }
+  if (bad && atomic_fetch_add(&printed, 1) < max_printed)
+  {
+    pthread_mutex_lock(&print_lock);
+    printf("%s: %s:%s\n", file, v->name, buf);
+    pthread_mutex_unlock(&print_lock);
+  }
+  return bad;
+}
+
+// Runs every vector in path. Vectors for opcodes the CPU does not implement
+// are skipped. Returns -1 if the file cannot be read or parsed.
+static int run_file(Machine* m, const char* path)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+  {
+    perror(path);
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0)
+  {
+    fprintf(stderr, "%s: empty or unreadable\n", path);
+    close(fd);
+    return -1;
+  }
+  const char* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+  {
+    perror(path);
+    return -1;
+  }
+  Parser ps = {data, data + st.st_size, 0};
+  Vector v;
+  unsigned long vectors = 0;
+  unsigned long failures = 0;
+  expect(&ps, '[');
+  if (!accept(&ps, ']'))
+  {
+    do
+    {
+      parse_vector(&ps, &v);
+      if (ps.error)
+      {
+        break;
+      }
+      // The opcode is whatever initial RAM holds at PC.
+      int op_code = -1;
+      for (int i = 0; i < v.initial.ram_count; i++)
+      {
+        if (v.initial.address[i] == v.initial.pc)
+        {
+          op_code = v.initial.value[i];
+        }
+      }
+      if (op_code < 0 || strcmp(mnemonic[op_code], "???") == 0)
+      {
+        continue;
+      }
+      vectors++;
+      failures += run_vector(m, path, &v);
+    } while (accept(&ps, ','));
+    expect(&ps, ']');
+  }
+  munmap((void*)data, st.st_size);
+  atomic_fetch_add(&vector_count, vectors);
+  atomic_fetch_add(&failure_count, failures);
+  if (ps.error)
+  {
+    fprintf(stderr, "%s: parse error at byte %ld\n", path, (long)(ps.p - data));
+    return -1;
+  }
+  return 0;
+}
+
+static void* worker(void* arg)
+{
+  int* errors = arg;
+  Machine* m = machine_create();
+  if (m == NULL)
+  {
+    *errors = 1;
+    return NULL;
+  }
+  m->brk_interrupt = 1;
+  for (int i; (i = atomic_fetch_add(&next_file, 1)) < file_count;)
+  {
+    if (run_file(m, files[i]) != 0)
+    {
+      *errors = 1;
+    }
+  }
+  machine_destroy(m);
+  return NULL;
+}
+
+static int add_file(const char* path)
+{
+  char** grown = realloc(files, (file_count + 1) * sizeof *files);
+  if (grown == NULL || (grown[file_count] = strdup(path)) == NULL)
+  {
+    return -1;
+  }
+  files = grown;
+  file_count++;
+  return 0;
+}
+
+// Adds path, or every *.json inside it if it is a directory.
+static int add_path(const char* path)
+{
+  DIR* dir = opendir(path);
+  if (dir == NULL)
+  {
+    return add_file(path);
+  }
+  struct dirent* entry;
+  int result = 0;
+  while (result == 0 && (entry = readdir(dir)) != NULL)
+  {
+    size_t len = strlen(entry->d_name);
+    if (len > 5 && strcmp(entry->d_name + len - 5, ".json") == 0)
+    {
+      char full[4096];
+      snprintf(full, sizeof full, "%s/%s", path, entry->d_name);
+      result = add_file(full);
+    }
+  }
+  closedir(dir);
+  return result;
+}
+
+static void usage(const char* name)
+{
+  fprintf(stderr, "usage: %s [-j threads] [-f max-printed] file.json|directory...\n", name);
+}
+
+int main(int argc, char** argv)
+{
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  int opt;
+  while ((opt = getopt(argc, argv, "j:f:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'j':
+      threads = atol(optarg);
+      break;
+    case 'f':
+      max_printed = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (optind == argc || threads < 1)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+  for (int i = optind; i < argc; i++)
+  {
+    if (add_path(argv[i]) != 0)
+    {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+  }
+  if (threads > file_count)
+  {
+    threads = file_count > 0 ? file_count : 1;
+  }
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pthread_t* tids = calloc(threads, sizeof *tids);
+  int* errors = calloc(threads, sizeof *errors);
+  if (tids == NULL || errors == NULL)
+  {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  long started = 0;
+  while (started < threads && pthread_create(&tids[started], NULL, worker, &errors[started]) == 0)
+  {
+    started++;
+  }
+  if (started == 0)
+  {
+    // No threads to be had, run everything here.
+    worker(&errors[0]);
+  }
+  int failed_files = 0;
+  for (long i = 0; i < threads; i++)
+  {
+    if (i < started)
+    {
+      pthread_join(tids[i], NULL);
+    }
+    failed_files |= errors[i];
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  unsigned long vectors = atomic_load(&vector_count);
+  unsigned long failures = atomic_load(&failure_count);
+  printf("%lu vectors in %d files, %lu failed, %.2fs on %ld threads\n", vectors, file_count,
+         failures, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9,
+         started > 0 ? started : 1);
+  free(tids);
+  free(errors);
+  return failures != 0 || failed_files || vectors == 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "profile.h"
+
+#include <stdlib.h>
+
+#include "disasm.h"
+
+Profile* profile_create(void)
+{
+  Profile* p = calloc(1, sizeof *p);
+  if (p != NULL)
+  {
+    p->leader = 1;
+  }
+  return p;
+}
+
+void profile_destroy(Profile* p)
+{
+  free(p);
+}
+
+// Fills index with the (up to) top largest nonzero entries of counts, largest
+// first, and returns how many there are. top is small, so a plain insertion
+// beats sorting all n.
+static int hottest(const unsigned long long* counts, int n, int* index, int top)
+{
+  int found = 0;
+  for (int i = 0; i < n; i++)
+  {
+    if (counts[i] == 0 || (found == top && counts[i] <= counts[index[found - 1]]))
+    {
+      continue;
+    }
+    int j = found < top ? found++ : top - 1;
+    for (; j > 0 && counts[index[j - 1]] < counts[i]; j--)
+    {
+      index[j] = index[j - 1];
+    }
+    index[j] = i;
+  }
+  return found;
+}
+
+static void print_instruction(FILE* out, const Machine* m, WORD pc)
+{
+  char text[32];
+  BYTE op_code = mem_peek(m, pc);
+  WORD operand = 0;
+  if (instruction_length[op_code] > 1)
+  {
+    operand = mem_peek(m, pc + 1);
+  }
+  if (instruction_length[op_code] > 2)
+  {
+    operand |= mem_peek(m, pc + 2) << 8;
+  }
+  disasm(text, sizeof text, pc, op_code, operand);
+  fprintf(out, "%04X  %s", pc, text);
+}
+
+void profile_report(const Profile* p, const Machine* m, FILE* out, int top)
+{
+  int* index = malloc(top * sizeof *index);
+  if (index == NULL)
+  {
+    return;
+  }
+  unsigned long long total = 0;
+  for (int i = 0; i < 256; i++)
+  {
+    total += p->op_count[i];
+  }
+  fprintf(out, "profile: %llu instructions\n", total);
+  if (total == 0)
+  {
+    free(index);
+    return;
+  }
+
+  fprintf(out, "\nhottest opcodes\n%12s %6s  %-19s %s\n", "count", "share", "opcode", "flags");
+  int n = hottest(p->op_count, 256, index, top);
+  for (int i = 0; i < n; i++)
+  {
+    fprintf(out, "%12llu %5.1f%%  %02X %-16s %s\n", p->op_count[index[i]],
+            100.0 * p->op_count[index[i]] / total, index[i], opcode_name[index[i]],
+            flags_affected[index[i]]);
+  }
+
+  fprintf(out, "\nhottest addresses\n%12s %6s\n", "count", "share");
+  n = hottest(p->pc_count, 65536, index, top);
+  for (int i = 0; i < n; i++)
+  {
+    fprintf(out, "%12llu %5.1f%%  ", p->pc_count[index[i]], 100.0 * p->pc_count[index[i]] / total);
+    print_instruction(out, m, index[i]);
+    fprintf(out, "\n");
+  }
+
+  // Ranked by the instructions spent in them, not by how often they start.
+  fprintf(out, "\nhottest blocks\n%12s %6s %12s %6s\n", "insns", "share", "entries", "length");
+  n = hottest(p->block_insns, 65536, index, top);
+  for (int i = 0; i < n; i++)
+  {
+    unsigned long long insns = p->block_insns[index[i]];
+    unsigned long long entries = p->block_entries[index[i]];
+    fprintf(out, "%12llu %5.1f%% %12llu %6.1f  ", insns, 100.0 * insns / total, entries,
+            entries != 0 ? (double)insns / entries : 0.0);
+    print_instruction(out, m, index[i]);
+    fprintf(out, "\n");
+  }
+  free(index);
+}
@@ -0,0 +1,51 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+
+#include "cpu.h"
+
+// Guest profile. With PROFILE the core counts every instruction it fetches
+// while Machine.profile is set; without it none of this is compiled in.
+//
+// A block here is what the block cache would translate: it starts at the
+// first instruction after a branch, jump, call, return or BRK.
+
+typedef struct Profile
+{
+  unsigned long long op_count[256];
+  unsigned long long pc_count[65536];
+  // Indexed by the block's first address.
+  unsigned long long block_entries[65536];
+  unsigned long long block_insns[65536];
+  // Where the running block started, and whether the next instruction starts
+  // a new one.
+  WORD block;
+  BYTE leader;
+} Profile;
+
+// All counters zero. Returns NULL when out of memory.
+Profile* profile_create(void);
+void profile_destroy(Profile* p);
+// Prints the top hottest opcodes, addresses and blocks. Memory is only used to
+// disassemble the addresses.
+void profile_report(const Profile* p, const Machine* m, FILE* out, int top);
+
+#endif
@@ -0,0 +1,466 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "replay.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_MAGIC "R65\x02"
+
+typedef struct
+{
+  CPU cpu;
+  unsigned long long cycles;
+  unsigned long long instructions;
+  // Log entries before this point.
+  size_t reads;
+  size_t interrupts;
+  BYTE memory[1 * 64 * 1024];
+} Keyframe;
+
+// An interrupt the recorded machine took, and the cycle it was taken on.
+typedef struct
+{
+  unsigned long long cycle;
+  WORD vector;
+} LoggedInterrupt;
+
+// The file: this header, the keyframes and both logs, all in host byte order.
+// CPU changes with the build options, so files only fit the same build.
+typedef struct
+{
+  char magic[4];
+  WORD cpu_size;
+  BYTE brk_interrupt;
+  BYTE reserved;
+  unsigned long long interval;
+  unsigned long long last;
+  unsigned long long keyframes;
+  unsigned long long reads;
+  unsigned long long interrupts;
+  // Nonzero for the pages whose reads are in the log.
+  BYTE read_page[256];
+} RecordingHeader;
+
+struct Recording
+{
+  RecordingHeader header;
+  // The machine being recorded, NULL once stopped.
+  Machine* machine;
+  IoRead read[256];
+  IoWrite write[256];
+  void* context[256];
+  int failed;
+  Keyframe** keyframes;
+  size_t keyframe_capacity;
+  BYTE* log;
+  size_t log_capacity;
+  LoggedInterrupt* interrupts;
+  size_t interrupt_capacity;
+  // Next log entry a replaying machine reads.
+  size_t position;
+  // The machine replaying, and the next interrupt it takes.
+  Machine* replaying;
+  size_t next_interrupt;
+};
+
+static BYTE record_read(void* context, WORD address)
+{
+  Recording* r = context;
+  BYTE page = address >> 8;
+  BYTE value = r->read[page](r->context[page], address);
+  if (r->header.reads == r->log_capacity)
+  {
+    size_t capacity = r->log_capacity ? r->log_capacity * 2 : 64 * 1024;
+    BYTE* log = realloc(r->log, capacity);
+    if (log == NULL)
+    {
+      r->failed = 1;
+      return value;
+    }
+    r->log = log;
+    r->log_capacity = capacity;
+  }
+  r->log[r->header.reads++] = value;
+  return value;
+}
+
+static void record_write(void* context, WORD address, BYTE value)
+{
+  Recording* r = context;
+  BYTE page = address >> 8;
+  if (r->write[page] != NULL)
+  {
+    r->write[page](r->context[page], address, value);
+  }
+}
+
+// Past the end of the log the bus floats, like an unmapped read.
+static BYTE replay_read(void* context, WORD address)
+{
+  Recording* r = context;
+  if (!r->header.read_page[address >> 8] || r->position == r->header.reads)
+  {
+    return 0xFF;
+  }
+  return r->log[r->position++];
+}
+
+static void replay_write(void* context, WORD address, BYTE value)
+{
+  (void)context;
+  (void)address;
+  (void)value;
+}
+
+// Takes the next logged interrupt and queues the one after it.
+static void replay_interrupt(void* context)
+{
+  Recording* r = context;
+  cpu_interrupt(r->replaying, r->interrupts[r->next_interrupt++].vector);
+  if (r->next_interrupt < r->header.interrupts)
+  {
+    machine_schedule(r->replaying, r->interrupts[r->next_interrupt].cycle, replay_interrupt, r);
+  }
+}
+
+static int add_keyframe(Recording* r, Keyframe* k)
+{
+  if (r->header.keyframes == r->keyframe_capacity)
+  {
+    size_t capacity = r->keyframe_capacity ? r->keyframe_capacity * 2 : 16;
+    Keyframe** keyframes = realloc(r->keyframes, capacity * sizeof *keyframes);
+    if (keyframes == NULL)
+    {
+      return -1;
+    }
+    r->keyframes = keyframes;
+    r->keyframe_capacity = capacity;
+  }
+  r->keyframes[r->header.keyframes++] = k;
+  return 0;
+}
+
+static int take_keyframe(Recording* r)
+{
+  Machine* m = r->machine;
+  Keyframe* k = malloc(sizeof *k);
+  if (k == NULL || add_keyframe(r, k) != 0)
+  {
+    free(k);
+    return -1;
+  }
+  k->cpu = m->cpu;
+  k->cycles = m->cycles;
+  k->instructions = m->instructions;
+  k->reads = r->header.reads;
+  k->interrupts = r->header.interrupts;
+  memcpy(k->memory, m->memory, sizeof k->memory);
+  return 0;
+}
+
+Recording* recording_start(Machine* m, unsigned long long interval)
+{
+  Recording* r = calloc(1, sizeof *r);
+  if (r == NULL)
+  {
+    return NULL;
+  }
+  memcpy(r->header.magic, REPLAY_MAGIC, 4);
+  r->header.cpu_size = sizeof(CPU);
+  r->header.brk_interrupt = m->brk_interrupt;
+  r->header.interval = interval ? interval : 1;
+  r->header.last = m->instructions;
+  r->machine = m;
+  m->recording = r;
+  if (take_keyframe(r) != 0)
+  {
+    recording_destroy(r);
+    return NULL;
+  }
+  for (int page = 0; page < 256; page++)
+  {
+    if (m->page_type[page] == PAGE_IO && m->io_read[page] != NULL)
+    {
+      r->header.read_page[page] = 1;
+      r->read[page] = m->io_read[page];
+      r->write[page] = m->io_write[page];
+      r->context[page] = m->io_context[page];
+      machine_map_io(m, page << 8, page << 8 | 0xFF, record_read, record_write, r);
+    }
+  }
+  return r;
+}
+
+// Runs in pieces that end on keyframes. A piece starting on a breakpoint
+// would step over it, so that is checked here instead.
+StopReason recording_run(Recording* r, unsigned long budget)
+{
+  Machine* m = r->machine;
+  unsigned long long end = m->instructions + budget;
+  for (int first = 1;; first = 0)
+  {
+    Keyframe* k = r->keyframes[r->header.keyframes - 1];
+    if (m->instructions - k->instructions >= r->header.interval && !r->failed &&
+        take_keyframe(r) != 0)
+    {
+      r->failed = 1;
+    }
+    if (m->instructions == end)
+    {
+      return STOP_BUDGET;
+    }
+    WORD pc = m->cpu.PC;
+    if (!first && ADDRESS_BIT(m->breakpoints, pc))
+    {
+      return STOP_BREAKPOINT;
+    }
+    k = r->keyframes[r->header.keyframes - 1];
+    unsigned long long stop = end;
+    if (!r->failed && k->instructions + r->header.interval < stop)
+    {
+      stop = k->instructions + r->header.interval;
+    }
+    StopReason reason = cpu_run(m, stop - m->instructions);
+    // Anything after running out of memory cannot be replayed.
+    if (!r->failed)
+    {
+      r->header.last = m->instructions;
+    }
+    if (reason != STOP_BUDGET)
+    {
+      return reason;
+    }
+  }
+}
+
+void recording_stop(Recording* r)
+{
+  Machine* m = r->machine;
+  if (m == NULL)
+  {
+    return;
+  }
+  for (int page = 0; page < 256; page++)
+  {
+    if (r->header.read_page[page])
+    {
+      machine_map_io(m, page << 8, page << 8 | 0xFF, r->read[page], r->write[page],
+                     r->context[page]);
+    }
+  }
+  m->recording = NULL;
+  r->machine = NULL;
+}
+
+void recording_interrupt(Recording* r, const Machine* m, WORD vector)
+{
+  if (r->header.interrupts == r->interrupt_capacity)
+  {
+    size_t capacity = r->interrupt_capacity ? r->interrupt_capacity * 2 : 256;
+    LoggedInterrupt* interrupts = realloc(r->interrupts, capacity * sizeof *interrupts);
+    if (interrupts == NULL)
+    {
+      r->failed = 1;
+      return;
+    }
+    r->interrupts = interrupts;
+    r->interrupt_capacity = capacity;
+  }
+  LoggedInterrupt* entry = &r->interrupts[r->header.interrupts++];
+  entry->cycle = m->cycles;
+  entry->vector = vector;
+}
+
+void recording_destroy(Recording* r)
+{
+  if (r == NULL)
+  {
+    return;
+  }
+  recording_stop(r);
+  for (size_t i = 0; i < r->header.keyframes; i++)
+  {
+    free(r->keyframes[i]);
+  }
+  free(r->keyframes);
+  free(r->log);
+  free(r->interrupts);
+  free(r);
+}
+
+int recording_save(const Recording* r, const char* path)
+{
+  FILE* file = fopen(path, "wb");
+  if (file == NULL)
+  {
+    return -1;
+  }
+  int ok = fwrite(&r->header, sizeof r->header, 1, file) == 1;
+  for (size_t i = 0; ok && i < r->header.keyframes; i++)
+  {
+    ok = fwrite(r->keyframes[i], sizeof(Keyframe), 1, file) == 1;
+  }
+  ok = ok && fwrite(r->log, 1, r->header.reads, file) == r->header.reads;
+  ok = ok && fwrite(r->interrupts, sizeof *r->interrupts, r->header.interrupts, file) ==
+                 r->header.interrupts;
+  int error = errno;
+  if (!ok)
+  {
+    fclose(file);
+    errno = error;
+    return -1;
+  }
+  return fclose(file) == 0 ? 0 : -1;
+}
+
+Recording* recording_load(const char* path)
+{
+  FILE* file = fopen(path, "rb");
+  if (file == NULL)
+  {
+    return NULL;
+  }
+  // Anything short or different is not a recording of this build.
+  int error = EINVAL;
+  RecordingHeader header;
+  Recording* r = calloc(1, sizeof *r);
+  if (r == NULL)
+  {
+    error = ENOMEM;
+    goto fail;
+  }
+  if (fread(&header, sizeof header, 1, file) != 1 ||
+      memcmp(header.magic, REPLAY_MAGIC, 4) != 0 || header.cpu_size != sizeof(CPU) ||
+      header.keyframes == 0)
+  {
+    goto fail;
+  }
+  for (size_t i = 0; i < header.keyframes; i++)
+  {
+    Keyframe* k = malloc(sizeof *k);
+    if (k == NULL || add_keyframe(r, k) != 0)
+    {
+      free(k);
+      error = ENOMEM;
+      goto fail;
+    }
+    if (fread(k, sizeof *k, 1, file) != 1)
+    {
+      goto fail;
+    }
+  }
+  r->log = malloc(header.reads ? header.reads : 1);
+  if (r->log == NULL)
+  {
+    error = ENOMEM;
+    goto fail;
+  }
+  if (fread(r->log, 1, header.reads, file) != header.reads)
+  {
+    goto fail;
+  }
+  r->interrupts = malloc(header.interrupts ? header.interrupts * sizeof *r->interrupts : 1);
+  if (r->interrupts == NULL)
+  {
+    error = ENOMEM;
+    goto fail;
+  }
+  if (fread(r->interrupts, sizeof *r->interrupts, header.interrupts, file) !=
+      header.interrupts)
+  {
+    goto fail;
+  }
+  fclose(file);
+  r->header = header;
+  r->log_capacity = header.reads;
+  r->interrupt_capacity = header.interrupts;
+  return r;
+fail:
+  fclose(file);
+  recording_destroy(r);
+  errno = error;
+  return NULL;
+}
+
+unsigned long long recording_first(const Recording* r)
+{
+  return r->keyframes[0]->instructions;
+}
+
+unsigned long long recording_last(const Recording* r)
+{
+  return r->header.last;
+}
+
+int replay_seek(Recording* r, Machine* m, unsigned long long instruction)
+{
+  if (m == r->machine || instruction < recording_first(r) || instruction > r->header.last)
+  {
+    return -1;
+  }
+  // The last keyframe at or before instruction.
+  size_t low = 0;
+  size_t high = r->header.keyframes;
+  while (high - low > 1)
+  {
+    size_t middle = low + (high - low) / 2;
+    if (r->keyframes[middle]->instructions <= instruction)
+    {
+      low = middle;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+  const Keyframe* k = r->keyframes[low];
+  m->cpu = k->cpu;
+  m->cycles = k->cycles;
+  m->instructions = k->instructions;
+  m->brk_interrupt = r->header.brk_interrupt;
+  mem_load(m, 0, k->memory, sizeof k->memory);
+  for (int page = 0; page < 256; page++)
+  {
+    if (r->header.read_page[page])
+    {
+      machine_map_io(m, page << 8, page << 8 | 0xFF, replay_read, replay_write, r);
+    }
+  }
+  r->position = k->reads;
+  // Whatever the devices had coming is not what the recording did.
+  machine_cancel_all(m);
+  r->replaying = m;
+  r->next_interrupt = k->interrupts;
+  if (r->next_interrupt < r->header.interrupts)
+  {
+    machine_schedule(m, r->interrupts[r->next_interrupt].cycle, replay_interrupt, r);
+  }
+  // A breakpoint or watchpoint on the way is passed by the next call.
+  while (m->instructions < instruction)
+  {
+    StopReason reason = cpu_run(m, instruction - m->instructions);
+    if (reason != STOP_BUDGET && reason != STOP_BREAKPOINT && reason != STOP_WATCHPOINT)
+    {
+      return -1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "cpu.h"
+
+// Deterministic record and replay. Everything a machine does follows from
+// its state except what devices hand it, so a recording is the values of all
+// device reads in order and the cycle of every interrupt taken, plus a
+// keyframe of the whole machine every so many instructions. Replaying any
+// point means loading the keyframe before it and running forward, with device
+// reads answered from the log and the interrupts taken where they were.
+
+typedef struct Recording Recording;
+
+// Starts recording m: a keyframe now and one every interval instructions from
+// recording_run(), and every value read from a device page from now until
+// recording_stop(). Returns NULL when out of memory.
+Recording* recording_start(Machine* m, unsigned long long interval);
+// cpu_run() for a machine being recorded.
+StopReason recording_run(Recording* r, unsigned long budget);
+// Gives the devices back to the machine. The recording can still be replayed
+// and saved.
+void recording_stop(Recording* r);
+void recording_destroy(Recording* r);
+// Returns 0, or -1 with errno set.
+int recording_save(const Recording* r, const char* path);
+// Returns NULL with errno set.
+Recording* recording_load(const char* path);
+// Instruction count of the recorded machine at the first keyframe and where
+// recording stopped.
+unsigned long long recording_first(const Recording* r);
+unsigned long long recording_last(const Recording* r);
+// Puts m into the state the recorded machine was in when its instruction
+// count was instruction. m needs the same memory map as the recorded machine.
+// From then on its device pages read from the recording, and writes to them
+// go nowhere. Its pending events are dropped and interrupts only come from
+// the recording, so it can carry on with cpu_run() up to recording_last().
+// Returns 0, or -1 when instruction is outside the recording.
+int replay_seek(Recording* r, Machine* m, unsigned long long instruction);
+
+// Called by the core for every interrupt the recorded machine takes, before
+// taking it.
+void recording_interrupt(Recording* r, const Machine* m, WORD vector);
+
+#endif
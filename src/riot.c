@@ -0,0 +1,252 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "riot.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+// Interrupt flags, as read back.
+enum
+{
+  FLAG_PA7 = 0x40,
+  FLAG_TIMER = 0x80,
+};
+
+// The cycle of an underflow that is not coming.
+#define NEVER ULLONG_MAX
+
+struct Riot
+{
+  Machine* machine;
+  unsigned irq;
+  BYTE ram[128];
+  BYTE dra;
+  BYTE ddra;
+  BYTE drb;
+  BYTE ddrb;
+  // What the outside drives the ports to.
+  BYTE pins[2];
+  BYTE flags;
+  BYTE timer_irq;
+  BYTE pa7_irq;
+  BYTE pa7_rising;
+  // The timer counts down from timer_value every 1 << shift cycles, starting
+  // at cycle timer_start, and every cycle after underflowing.
+  BYTE timer_value;
+  BYTE shift;
+  unsigned long long timer_start;
+  // When it underflows, and the one an event is pending for, NEVER for none.
+  unsigned long long underflow;
+  unsigned long long scheduled;
+};
+
+static BYTE timer_counter(const Riot* r, unsigned long long now)
+{
+  // Stepping back through the journal can take the cycle count below it.
+  unsigned long long since = now > r->timer_start ? now - r->timer_start : 0;
+  unsigned long long period = (unsigned long long)(r->timer_value + 1) << r->shift;
+  if (since < period)
+  {
+    return r->timer_value - (since >> r->shift);
+  }
+  return 0xFF - (since - period);
+}
+
+static void catch_up(Riot* r, unsigned long long now)
+{
+  if (r->underflow <= now)
+  {
+    r->flags |= FLAG_TIMER;
+    r->underflow = NEVER;
+  }
+}
+
+static void timer_event(void* context);
+
+// Brings the IRQ line and the pending event in line with the registers.
+static void settle(Riot* r)
+{
+  int asserted = (r->flags & FLAG_TIMER && r->timer_irq) || (r->flags & FLAG_PA7 && r->pa7_irq);
+  cpu_set_irq(r->machine, r->irq, asserted);
+  if (r->underflow != r->scheduled)
+  {
+    machine_cancel(r->machine, timer_event, r);
+    // With the event queue full the flag still gets set on the next access.
+    unsigned long long next = r->underflow;
+    if (next == NEVER || machine_schedule(r->machine, next, timer_event, r) != 0)
+    {
+      next = NEVER;
+    }
+    r->scheduled = next;
+  }
+}
+
+static void timer_event(void* context)
+{
+  Riot* r = context;
+  r->scheduled = NEVER;
+  catch_up(r, machine_now(r->machine));
+  settle(r);
+}
+
+// Register offsets: A2 clear are the ports, by A1 A0. With A2 set, reads
+// take A0 to choose between the timer and the flags, and writes A4 between
+// the timer (A1 A0 the divider) and the PA7 edge control.
+static BYTE read_register(Riot* r, BYTE offset, unsigned long long now)
+{
+  if (!(offset & 0x04))
+  {
+    switch (offset & 0x03)
+    {
+    case 0:
+      return riot_pins(r, RIOT_PORT_A);
+    case 1:
+      return r->ddra;
+    case 2:
+      return riot_pins(r, RIOT_PORT_B);
+    default:
+      return r->ddrb;
+    }
+  }
+  if (offset & 0x01)
+  {
+    BYTE flags = r->flags;
+    r->flags &= ~FLAG_PA7;
+    return flags;
+  }
+  r->timer_irq = (offset & 0x08) != 0;
+  r->flags &= ~FLAG_TIMER;
+  return timer_counter(r, now);
+}
+
+static void write_register(Riot* r, BYTE offset, BYTE value, unsigned long long now)
+{
+  static const BYTE shifts[4] = {0, 3, 6, 10};
+  if (!(offset & 0x04))
+  {
+    switch (offset & 0x03)
+    {
+    case 0:
+      r->dra = value;
+      break;
+    case 1:
+      r->ddra = value;
+      break;
+    case 2:
+      r->drb = value;
+      break;
+    default:
+      r->ddrb = value;
+      break;
+    }
+  }
+  else if (offset & 0x10)
+  {
+    r->timer_value = value;
+    r->shift = shifts[offset & 0x03];
+    r->timer_start = now;
+    r->timer_irq = (offset & 0x08) != 0;
+    r->flags &= ~FLAG_TIMER;
+    r->underflow = now + ((unsigned long long)(value + 1) << r->shift);
+  }
+  else
+  {
+    r->pa7_rising = offset & 0x01;
+    r->pa7_irq = (offset & 0x02) != 0;
+  }
+}
+
+static BYTE riot_read(void* context, WORD address)
+{
+  Riot* r = context;
+  if (!(address & 0x80))
+  {
+    return r->ram[address & 0x7F];
+  }
+  unsigned long long now = machine_now(r->machine);
+  catch_up(r, now);
+  BYTE value = read_register(r, address, now);
+  settle(r);
+  return value;
+}
+
+static void riot_write(void* context, WORD address, BYTE value)
+{
+  Riot* r = context;
+  if (!(address & 0x80))
+  {
+    r->ram[address & 0x7F] = value;
+    return;
+  }
+  unsigned long long now = machine_now(r->machine);
+  catch_up(r, now);
+  write_register(r, address, value, now);
+  settle(r);
+}
+
+Riot* riot_create(Machine* m, unsigned irq)
+{
+  Riot* r = calloc(1, sizeof *r);
+  if (r == NULL)
+  {
+    return NULL;
+  }
+  r->machine = m;
+  r->irq = irq;
+  r->pins[RIOT_PORT_A] = r->pins[RIOT_PORT_B] = 0xFF;
+  r->underflow = r->scheduled = NEVER;
+  return r;
+}
+
+void riot_map(Riot* r, WORD start, WORD end)
+{
+  machine_map_io(r->machine, start, end, riot_read, riot_write, r);
+}
+
+void riot_destroy(Riot* r)
+{
+  if (r == NULL)
+  {
+    return;
+  }
+  machine_cancel(r->machine, timer_event, r);
+  cpu_set_irq(r->machine, r->irq, 0);
+  free(r);
+}
+
+void riot_set_pins(Riot* r, int port, BYTE pins)
+{
+  BYTE pa7 = riot_pins(r, RIOT_PORT_A) & 0x80;
+  r->pins[port] = pins;
+  BYTE changed = pa7 ^ (riot_pins(r, RIOT_PORT_A) & 0x80);
+  if (changed && (pa7 == 0) == r->pa7_rising)
+  {
+    catch_up(r, machine_now(r->machine));
+    r->flags |= FLAG_PA7;
+    settle(r);
+  }
+}
+
+BYTE riot_pins(const Riot* r, int port)
+{
+  if (port == RIOT_PORT_A)
+  {
+    return (r->dra & r->ddra) | (r->pins[RIOT_PORT_A] & ~r->ddra);
+  }
+  return (r->drb & r->ddrb) | (r->pins[RIOT_PORT_B] & ~r->ddrb);
+}
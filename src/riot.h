@@ -0,0 +1,58 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RIOT_H
+#define RIOT_H
+
+#include "cpu.h"
+
+// MOS 6532 RAM-I/O-Timer: 128 bytes of RAM, two 8-bit ports, an 8-bit
+// interval timer and an interrupt output. Like the VIA's, the timer is worked
+// out from the cycle it was written on and its underflow is an event, so it
+// costs nothing while it counts.
+//
+// Address bit 7 stands in for the RS pin: offsets 00-7F of every page
+// mapped to it are the RAM, 80-FF the registers. Writing the timer with N and
+// a divider of D (1, 8, 64 or 1024) underflows (N + 1) * D cycles later,
+// after which it counts down every cycle until written again.
+
+typedef struct Riot Riot;
+
+enum
+{
+  RIOT_PORT_A,
+  RIOT_PORT_B,
+};
+
+// Creates a RIOT on m with everything zero, like after RESET. Its interrupt
+// output drives the irq bit(s) of the IRQ line. Returns NULL when out of
+// memory.
+Riot* riot_create(Machine* m, unsigned irq);
+// Maps RAM and registers over start..end, repeated every 256 bytes.
+void riot_map(Riot* r, WORD start, WORD end);
+// Cancels the timer, lets go of the IRQ line and frees r. Pages mapped to r
+// have to be mapped to something else first.
+void riot_destroy(Riot* r);
+
+// Drives the input pins of port from the outside. Pins programmed as outputs
+// are not affected. The edge chosen for PA7 sets its interrupt flag.
+void riot_set_pins(Riot* r, int port, BYTE pins);
+// The levels on the pins of port: the data register on outputs, what
+// riot_set_pins() set on inputs (all high at first).
+BYTE riot_pins(const Riot* r, int port);
+
+#endif
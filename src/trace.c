@@ -0,0 +1,281 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "disasm.h"
+
+// Records in the ring, a power of two.
+#define TRACE_RING_SIZE (1 << 16)
+// The file grows by this much whenever the mapping runs out.
+#define TRACE_FILE_CHUNK (16 * 1024 * 1024)
+// The writer sleeps once the ring is empty. The CPU looks whether it does
+// every this many records, so the writer gets them in batches and a fence and
+// maybe a syscall are spread over them. Records of a paused run wait for the
+// next batch or trace_close().
+#define TRACE_WAKE_RECORDS 4096
+
+// Single producer (the CPU) and single consumer (the writer). head and tail
+// only ever grow and are masked on use, so head - tail is the fill level.
+struct Trace
+{
+  TraceRecord ring[TRACE_RING_SIZE];
+  _Alignas(64) atomic_ulong head;
+  // The producer's last look at tail, saves touching the writer's cache line.
+  unsigned long tail_seen;
+  _Alignas(64) atomic_ulong tail;
+  atomic_int closing;
+  // Set while the writer is about to block on wake, an eventfd.
+  atomic_int sleeping;
+  int wake;
+  int failed;
+  pthread_t writer;
+  int fd;
+  BYTE* map;
+  size_t mapped;
+  size_t used;
+};
+
+// Makes room for size more bytes in the mapping.
+static int reserve(Trace* t, size_t size)
+{
+  if (t->used + size <= t->mapped)
+  {
+    return 0;
+  }
+  size_t mapped = t->mapped + TRACE_FILE_CHUNK;
+  if (t->map != NULL)
+  {
+    munmap(t->map, t->mapped);
+    t->map = NULL;
+  }
+  if (ftruncate(t->fd, mapped) != 0)
+  {
+    return -1;
+  }
+  void* map = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, t->fd, 0);
+  if (map == MAP_FAILED)
+  {
+    return -1;
+  }
+  t->map = map;
+  t->mapped = mapped;
+  return 0;
+}
+
+static void append(Trace* t, const void* data, size_t size)
+{
+  if (t->failed)
+  {
+    return;
+  }
+  if (reserve(t, size) != 0)
+  {
+    // Keep draining the ring so the CPU does not hang, the caller gets told
+    // on close.
+    t->failed = 1;
+    return;
+  }
+  memcpy(t->map + t->used, data, size);
+  t->used += size;
+}
+
+static void wake_writer(Trace* t)
+{
+  uint64_t one = 1;
+  // It only fails when the counter is already far from zero.
+  ssize_t written = write(t->wake, &one, sizeof one);
+  (void)written;
+}
+
+static void* writer_main(void* arg)
+{
+  Trace* t = arg;
+  unsigned long tail = atomic_load_explicit(&t->tail, memory_order_relaxed);
+  for (;;)
+  {
+    unsigned long head = atomic_load_explicit(&t->head, memory_order_acquire);
+    if (head == tail)
+    {
+      if (atomic_load_explicit(&t->closing, memory_order_acquire))
+      {
+        // Anything recorded before closing was set is visible by now.
+        if (atomic_load_explicit(&t->head, memory_order_acquire) == tail)
+        {
+          return NULL;
+        }
+        continue;
+      }
+      // Either this sees the new head or the CPU sees sleeping.
+      atomic_store(&t->sleeping, 1);
+      if (atomic_load(&t->head) == tail && !atomic_load(&t->closing))
+      {
+        uint64_t count;
+        if (read(t->wake, &count, sizeof count) < 0 && errno != EINTR)
+        {
+          t->failed = 1;
+        }
+      }
+      atomic_store_explicit(&t->sleeping, 0, memory_order_relaxed);
+      continue;
+    }
+    // Up to the end of the ring, the rest comes on the next round.
+    unsigned long start = tail & (TRACE_RING_SIZE - 1);
+    unsigned long count = head - tail;
+    if (count > TRACE_RING_SIZE - start)
+    {
+      count = TRACE_RING_SIZE - start;
+    }
+    append(t, &t->ring[start], count * sizeof(TraceRecord));
+    tail += count;
+    atomic_store_explicit(&t->tail, tail, memory_order_release);
+  }
+}
+
+Trace* trace_open(const char* path)
+{
+  Trace* t = calloc(1, sizeof(Trace));
+  if (t == NULL)
+  {
+    return NULL;
+  }
+  t->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (t->fd < 0)
+  {
+    free(t);
+    return NULL;
+  }
+  TraceHeader header = {TRACE_MAGIC, sizeof(TraceRecord), 0};
+  append(t, &header, sizeof header);
+  t->wake = t->failed ? -1 : eventfd(0, EFD_CLOEXEC);
+  int err = t->wake < 0 ? errno : pthread_create(&t->writer, NULL, writer_main, t);
+  if (err != 0)
+  {
+    if (t->map != NULL)
+    {
+      munmap(t->map, t->mapped);
+    }
+    if (t->wake >= 0)
+    {
+      close(t->wake);
+    }
+    close(t->fd);
+    unlink(path);
+    free(t);
+    errno = err;
+    return NULL;
+  }
+  return t;
+}
+
+int trace_close(Trace* t)
+{
+  atomic_store(&t->closing, 1);
+  wake_writer(t);
+  pthread_join(t->writer, NULL);
+  close(t->wake);
+  if (t->map != NULL)
+  {
+    munmap(t->map, t->mapped);
+  }
+  // Cut off the unused end of the last chunk.
+  int failed = t->failed || ftruncate(t->fd, t->used) != 0;
+  failed |= close(t->fd) != 0;
+  free(t);
+  return failed ? -1 : 0;
+}
+
+static WORD effective_address(const Machine* m, const Decoded* d, WORD pc)
+{
+  const CPU* cpu = &m->cpu;
+  WORD operand = d->operand;
+  switch (addressing_mode[d->op_code])
+  {
+  case MODE_ZEROPAGE:
+  case MODE_ABSOLUTE:
+    return operand;
+  case MODE_ZEROPAGE_X:
+    return (BYTE)(operand + cpu->X);
+  case MODE_ZEROPAGE_Y:
+    return (BYTE)(operand + cpu->Y);
+  case MODE_ABSOLUTE_X:
+    return operand + cpu->X;
+  case MODE_ABSOLUTE_Y:
+    return operand + cpu->Y;
+  case MODE_INDIRECT:
+    // The NMOS part never carries into the high byte of the pointer.
+    return mem_peek(m, operand) |
+           mem_peek(m, (operand & 0xFF00) | (BYTE)(operand + 1)) << 8;
+  case MODE_INDIRECT_X:
+  {
+    BYTE ptr = operand + cpu->X;
+    return mem_peek(m, ptr) | mem_peek(m, (BYTE)(ptr + 1)) << 8;
+  }
+  case MODE_INDIRECT_Y:
+    return (mem_peek(m, operand) | mem_peek(m, (BYTE)(operand + 1)) << 8) + cpu->Y;
+  case MODE_RELATIVE:
+    return pc + d->length + (signed char)operand;
+  default:
+    return 0;
+  }
+}
+
+void trace_record(Trace* t, Machine* m, const Decoded* d)
+{
+  unsigned long head = atomic_load_explicit(&t->head, memory_order_relaxed);
+  while (head - t->tail_seen == TRACE_RING_SIZE)
+  {
+    t->tail_seen = atomic_load_explicit(&t->tail, memory_order_acquire);
+    if (head - t->tail_seen == TRACE_RING_SIZE)
+    {
+      sched_yield();
+    }
+  }
+  const CPU* cpu = &m->cpu;
+  TraceRecord* r = &t->ring[head & (TRACE_RING_SIZE - 1)];
+  r->pc = cpu->PC;
+  r->address = effective_address(m, d, cpu->PC);
+  r->operand = d->operand;
+  r->op_code = d->op_code;
+  r->a = cpu->A;
+  r->x = cpu->X;
+  r->y = cpu->Y;
+  r->s = cpu->S;
+  r->p = cpu_status_byte(cpu);
+  atomic_store_explicit(&t->head, head + 1, memory_order_release);
+  if ((head + 1) % TRACE_WAKE_RECORDS == 0)
+  {
+    // Orders the store to head before the load of sleeping.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&t->sleeping, memory_order_relaxed))
+    {
+      wake_writer(t);
+    }
+  }
+}
@@ -0,0 +1,66 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "cpu.h"
+
+// Binary execution trace. With TRACE every instruction gets recorded as it is
+// fetched, before it runs, into a ring buffer that a writer thread drains into
+// a memory-mapped file. trace_decode prints such a file as text.
+//
+// The file is a TraceHeader followed by TraceRecords, both in host byte order.
+
+#define TRACE_MAGIC "T65\x01"
+
+typedef struct
+{
+  char magic[4];
+  WORD record_size;
+  WORD reserved;
+} TraceHeader;
+
+typedef struct
+{
+  WORD pc;
+  // What the instruction reads or writes, the target for branches and jumps,
+  // 0 for modes without an address.
+  WORD address;
+  WORD operand;
+  BYTE op_code;
+  // Registers before the instruction runs.
+  BYTE a;
+  BYTE x;
+  BYTE y;
+  BYTE s;
+  BYTE p;
+} TraceRecord;
+
+typedef struct Trace Trace;
+
+// Creates path and starts the writer thread. Returns NULL with errno set when
+// the file cannot be set up.
+Trace* trace_open(const char* path);
+// Waits for the writer to catch up and closes the file. Returns 0, or -1 if
+// anything could not be written.
+int trace_close(Trace* t);
+// Called by the core for every instruction. Blocks while the ring is full
+// rather than dropping records.
+void trace_record(Trace* t, Machine* m, const Decoded* d);
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Prints a binary trace written by emulator -t as one line per instruction.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "disasm.h"
+#include "trace.h"
+
+static void print_record(const TraceRecord* r)
+{
+  static const char flags[] = "NV-BDIZC";
+  char text[16];
+  char p[9];
+  disasm(text, sizeof text, r->pc, r->op_code, r->operand);
+  for (int i = 0; i < 8; i++)
+  {
+    p[i] = r->p & (0x80 >> i) ? flags[i] : '.';
+  }
+  p[8] = '\0';
+  printf("%04X  %02X  %-12s A=%02X X=%02X Y=%02X S=%02X P=%s", r->pc, r->op_code, text, r->a,
+         r->x, r->y, r->s, p);
+  BYTE mode = addressing_mode[r->op_code];
+  if (mode != MODE_IMPLIED && mode != MODE_ACCUMULATOR && mode != MODE_IMMEDIATE)
+  {
+    printf(" @%04X", r->address);
+  }
+  putchar('\n');
+}
+
+int main(int argc, char** argv)
+{
+  if (argc != 2)
+  {
+    fprintf(stderr, "usage: %s trace.bin\n", argv[0]);
+    return 2;
+  }
+  int fd = open(argv[1], O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0)
+  {
+    perror(argv[1]);
+    return 1;
+  }
+  size_t size = st.st_size;
+  const TraceHeader* header = NULL;
+  if (size >= sizeof(TraceHeader))
+  {
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    header = map == MAP_FAILED ? NULL : map;
+  }
+  close(fd);
+  if (header == NULL || memcmp(header->magic, TRACE_MAGIC, 4) != 0 ||
+      header->record_size != sizeof(TraceRecord))
+  {
+    fprintf(stderr, "%s: not a trace file\n", argv[1]);
+    return 1;
+  }
+  const TraceRecord* r = (const TraceRecord*)(header + 1);
+  size_t count = (size - sizeof(TraceHeader)) / sizeof(TraceRecord);
+  for (size_t i = 0; i < count; i++)
+  {
+    print_record(&r[i]);
+  }
+  munmap((void*)header, size);
+  return 0;
+}
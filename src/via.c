@@ -0,0 +1,439 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "via.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+// Registers, by the low four address bits.
+enum
+{
+  REG_ORB,
+  REG_ORA,
+  REG_DDRB,
+  REG_DDRA,
+  REG_T1C_L,
+  REG_T1C_H,
+  REG_T1L_L,
+  REG_T1L_H,
+  REG_T2C_L,
+  REG_T2C_H,
+  REG_SR,
+  REG_ACR,
+  REG_PCR,
+  REG_IFR,
+  REG_IER,
+  // ORA without the handshake.
+  REG_ORA_NH,
+};
+
+// Interrupt flags, IFR and IER.
+enum
+{
+  IFR_CA2 = 0x01,
+  IFR_CA1 = 0x02,
+  IFR_SR = 0x04,
+  IFR_CB2 = 0x08,
+  IFR_CB1 = 0x10,
+  IFR_T2 = 0x20,
+  IFR_T1 = 0x40,
+};
+
+#define ACR_T2_PULSES 0x20
+#define ACR_T1_FREE_RUN 0x40
+#define ACR_T1_PB7 0x80
+// The cycle of an underflow that is not coming.
+#define NEVER ULLONG_MAX
+
+struct Via
+{
+  Machine* machine;
+  unsigned irq;
+  BYTE orb;
+  BYTE ora;
+  BYTE ddrb;
+  BYTE ddra;
+  // What the outside drives the ports and CA1/CB1 to.
+  BYTE pins[2];
+  BYTE control[2];
+  BYTE sr;
+  BYTE acr;
+  BYTE pcr;
+  BYTE ifr;
+  BYTE ier;
+  // T1 counts down from t1_value, starting at cycle t1_start. After 0 it
+  // shows FFFF (-1) for a cycle and reloads from the latch.
+  WORD t1_latch;
+  long t1_value;
+  unsigned long long t1_start;
+  // Set by loading T1, cleared by its interrupt in one-shot mode.
+  BYTE t1_armed;
+  BYTE pb7;
+  // T2 counts down from t2_value, starting at cycle t2_start, and wraps
+  // around instead of reloading. Counting pulses, t2_value is the count.
+  BYTE t2_latch;
+  WORD t2_value;
+  unsigned long long t2_start;
+  BYTE t2_armed;
+  // The next underflows that do something, and the one an event is pending
+  // for, NEVER for none.
+  unsigned long long t1_next;
+  unsigned long long t2_next;
+  unsigned long long scheduled;
+};
+
+static unsigned long long since(unsigned long long start, unsigned long long now)
+{
+  // Stepping back through the journal can take the cycle count below it.
+  return now > start ? now - start : 0;
+}
+
+static long t1_counter(const Via* v, unsigned long long now)
+{
+  long long value = v->t1_value - (long long)since(v->t1_start, now);
+  if (value < -1)
+  {
+    value = v->t1_latch - (-2 - value) % (v->t1_latch + 2);
+  }
+  return value;
+}
+
+static WORD t2_counter(const Via* v, unsigned long long now)
+{
+  if (v->acr & ACR_T2_PULSES)
+  {
+    return v->t2_value;
+  }
+  return v->t2_value - since(v->t2_start, now);
+}
+
+// The next time T1 goes from 0 to FFFF after now.
+static unsigned long long t1_underflow(const Via* v, unsigned long long now)
+{
+  long value = t1_counter(v, now);
+  return now + (value < 0 ? v->t1_latch + 2 : value + 1);
+}
+
+static void update_t1(Via* v, unsigned long long now)
+{
+  v->t1_next = v->t1_armed || (v->acr & ACR_T1_FREE_RUN) ? t1_underflow(v, now) : NEVER;
+}
+
+static void update_t2(Via* v, unsigned long long now)
+{
+  v->t2_next = v->t2_armed && !(v->acr & ACR_T2_PULSES) ? now + t2_counter(v, now) + 1 : NEVER;
+}
+
+// PB7 as T1 leaves it by now. Free running, each underflow flips it.
+static BYTE t1_pb7(const Via* v, unsigned long long now)
+{
+  if (v->t1_next > now)
+  {
+    return v->pb7;
+  }
+  if (!(v->acr & ACR_T1_FREE_RUN))
+  {
+    return 1;
+  }
+  return v->pb7 ^ (((now - v->t1_next) / (v->t1_latch + 2) + 1) & 1);
+}
+
+// Sets the flags of the underflows due by now.
+static void catch_up(Via* v, unsigned long long now)
+{
+  if (v->t1_next <= now)
+  {
+    v->ifr |= IFR_T1;
+    v->pb7 = t1_pb7(v, now);
+    if (v->acr & ACR_T1_FREE_RUN)
+    {
+      // Without an event for each, any number of them can have gone by.
+      unsigned long long period = v->t1_latch + 2;
+      v->t1_next += ((now - v->t1_next) / period + 1) * period;
+    }
+    else
+    {
+      v->t1_armed = 0;
+      v->t1_next = NEVER;
+    }
+  }
+  if (v->t2_next <= now)
+  {
+    v->ifr |= IFR_T2;
+    v->t2_armed = 0;
+    v->t2_next = NEVER;
+  }
+}
+
+static void timer_event(void* context);
+
+// Brings the IRQ line and the pending event in line with the registers. Only
+// an underflow that raises the IRQ needs an event, one that is masked or
+// already flagged waits for the next access to be counted.
+static void settle(Via* v)
+{
+  cpu_set_irq(v->machine, v->irq, (v->ifr & v->ier & 0x7F) != 0);
+  BYTE wanted = v->ier & ~v->ifr;
+  unsigned long long t1 = wanted & IFR_T1 ? v->t1_next : NEVER;
+  unsigned long long t2 = wanted & IFR_T2 ? v->t2_next : NEVER;
+  unsigned long long next = t1 < t2 ? t1 : t2;
+  if (next != v->scheduled)
+  {
+    machine_cancel(v->machine, timer_event, v);
+    // With the event queue full the flags still get set on the next access.
+    if (next == NEVER || machine_schedule(v->machine, next, timer_event, v) != 0)
+    {
+      next = NEVER;
+    }
+    v->scheduled = next;
+  }
+}
+
+static void timer_event(void* context)
+{
+  Via* v = context;
+  v->scheduled = NEVER;
+  catch_up(v, machine_now(v->machine));
+  settle(v);
+}
+
+static BYTE read_register(Via* v, int reg, unsigned long long now)
+{
+  switch (reg)
+  {
+  case REG_ORB:
+    v->ifr &= ~(IFR_CB1 | IFR_CB2);
+    return via_pins(v, VIA_PORT_B);
+  case REG_ORA:
+    v->ifr &= ~(IFR_CA1 | IFR_CA2);
+    return via_pins(v, VIA_PORT_A);
+  case REG_DDRB:
+    return v->ddrb;
+  case REG_DDRA:
+    return v->ddra;
+  case REG_T1C_L:
+    v->ifr &= ~IFR_T1;
+    return t1_counter(v, now);
+  case REG_T1C_H:
+    return (WORD)t1_counter(v, now) >> 8;
+  case REG_T1L_L:
+    return v->t1_latch;
+  case REG_T1L_H:
+    return v->t1_latch >> 8;
+  case REG_T2C_L:
+    v->ifr &= ~IFR_T2;
+    return t2_counter(v, now);
+  case REG_T2C_H:
+    return t2_counter(v, now) >> 8;
+  case REG_SR:
+    v->ifr &= ~IFR_SR;
+    return v->sr;
+  case REG_ACR:
+    return v->acr;
+  case REG_PCR:
+    return v->pcr;
+  case REG_IFR:
+    return v->ifr | ((v->ifr & v->ier & 0x7F) != 0) << 7;
+  case REG_IER:
+    return v->ier | 0x80;
+  default: // REG_ORA_NH
+    return via_pins(v, VIA_PORT_A);
+  }
+}
+
+static void write_register(Via* v, int reg, BYTE value, unsigned long long now)
+{
+  switch (reg)
+  {
+  case REG_ORB:
+    v->orb = value;
+    v->ifr &= ~(IFR_CB1 | IFR_CB2);
+    break;
+  case REG_ORA:
+    v->ora = value;
+    v->ifr &= ~(IFR_CA1 | IFR_CA2);
+    break;
+  case REG_DDRB:
+    v->ddrb = value;
+    break;
+  case REG_DDRA:
+    v->ddra = value;
+    break;
+  case REG_T1C_L:
+  case REG_T1L_L:
+  case REG_T1L_H:
+    // The count so far went by the old latch, it goes on from here.
+    v->t1_value = t1_counter(v, now);
+    v->t1_start = now;
+    if (reg == REG_T1L_H)
+    {
+      v->t1_latch = (v->t1_latch & 0x00FF) | value << 8;
+      v->ifr &= ~IFR_T1;
+    }
+    else
+    {
+      v->t1_latch = (v->t1_latch & 0xFF00) | value;
+    }
+    update_t1(v, now);
+    break;
+  case REG_T1C_H:
+    v->t1_latch = (v->t1_latch & 0x00FF) | value << 8;
+    v->t1_value = v->t1_latch;
+    v->t1_start = now;
+    v->t1_armed = 1;
+    v->pb7 = 0;
+    v->ifr &= ~IFR_T1;
+    update_t1(v, now);
+    break;
+  case REG_T2C_L:
+    v->t2_latch = value;
+    break;
+  case REG_T2C_H:
+    v->t2_value = v->t2_latch | value << 8;
+    v->t2_start = now;
+    v->t2_armed = 1;
+    v->ifr &= ~IFR_T2;
+    update_t2(v, now);
+    break;
+  case REG_SR:
+    v->sr = value;
+    v->ifr &= ~IFR_SR;
+    break;
+  case REG_ACR:
+    // Switching T2 between counting cycles and pulses keeps its count.
+    v->t2_value = t2_counter(v, now);
+    v->t2_start = now;
+    v->acr = value;
+    update_t1(v, now);
+    update_t2(v, now);
+    break;
+  case REG_PCR:
+    v->pcr = value;
+    break;
+  case REG_IFR:
+    v->ifr &= ~(value & 0x7F);
+    break;
+  case REG_IER:
+    if (value & 0x80)
+    {
+      v->ier |= value & 0x7F;
+    }
+    else
+    {
+      v->ier &= ~value;
+    }
+    break;
+  default: // REG_ORA_NH
+    v->ora = value;
+    break;
+  }
+}
+
+static BYTE via_read(void* context, WORD address)
+{
+  Via* v = context;
+  unsigned long long now = machine_now(v->machine);
+  catch_up(v, now);
+  BYTE value = read_register(v, address & 0x0F, now);
+  settle(v);
+  return value;
+}
+
+static void via_write(void* context, WORD address, BYTE value)
+{
+  Via* v = context;
+  unsigned long long now = machine_now(v->machine);
+  catch_up(v, now);
+  write_register(v, address & 0x0F, value, now);
+  settle(v);
+}
+
+Via* via_create(Machine* m, unsigned irq)
+{
+  Via* v = calloc(1, sizeof *v);
+  if (v == NULL)
+  {
+    return NULL;
+  }
+  v->machine = m;
+  v->irq = irq;
+  v->pins[VIA_PORT_A] = v->pins[VIA_PORT_B] = 0xFF;
+  v->control[VIA_CA1] = v->control[VIA_CB1] = 1;
+  v->pb7 = 1;
+  v->t1_next = v->t2_next = v->scheduled = NEVER;
+  return v;
+}
+
+void via_map(Via* v, WORD start, WORD end)
+{
+  machine_map_io(v->machine, start, end, via_read, via_write, v);
+}
+
+void via_destroy(Via* v)
+{
+  if (v == NULL)
+  {
+    return;
+  }
+  machine_cancel(v->machine, timer_event, v);
+  cpu_set_irq(v->machine, v->irq, 0);
+  free(v);
+}
+
+void via_set_pins(Via* v, int port, BYTE pins)
+{
+  BYTE fell = v->pins[port] & ~pins;
+  v->pins[port] = pins;
+  if (port == VIA_PORT_B && (fell & ~v->ddrb & 0x40) && (v->acr & ACR_T2_PULSES))
+  {
+    catch_up(v, machine_now(v->machine));
+    if (--v->t2_value == 0 && v->t2_armed)
+    {
+      v->ifr |= IFR_T2;
+      v->t2_armed = 0;
+    }
+    settle(v);
+  }
+}
+
+BYTE via_pins(const Via* v, int port)
+{
+  if (port == VIA_PORT_A)
+  {
+    return (v->ora & v->ddra) | (v->pins[VIA_PORT_A] & ~v->ddra);
+  }
+  BYTE pins = (v->orb & v->ddrb) | (v->pins[VIA_PORT_B] & ~v->ddrb);
+  if (v->acr & ACR_T1_PB7)
+  {
+    pins = (pins & 0x7F) | t1_pb7(v, machine_now(v->machine)) << 7;
+  }
+  return pins;
+}
+
+void via_set_control(Via* v, int line, int level)
+{
+  level = level != 0;
+  int positive = line == VIA_CA1 ? v->pcr & 0x01 : v->pcr & 0x10;
+  if (level != v->control[line] && level == (positive != 0))
+  {
+    catch_up(v, machine_now(v->machine));
+    v->ifr |= line == VIA_CA1 ? IFR_CA1 : IFR_CB1;
+    settle(v);
+  }
+  v->control[line] = level;
+}
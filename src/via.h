@@ -0,0 +1,68 @@
+/*
+ * 6502 Emulator
+ * Copyright (C) 2026 Deltalay
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef VIA_H
+#define VIA_H
+
+#include "cpu.h"
+
+// MOS 6522 Versatile Interface Adapter: two 8-bit ports, two 16-bit timers
+// and an interrupt output. The timers do not tick along with the CPU. Each
+// keeps the cycle it was loaded on, its value is worked out from that when
+// read, and an underflow is an event (machine_schedule()) only while it would
+// raise the IRQ. Masked or already flagged ones are worked out, PB7 included,
+// on the next access, so a running timer costs nothing between interrupts.
+// Writes take effect on the cycle the writing instruction ends on
+// (machine_now()); T1 and T2 loaded with N underflow N + 1 cycles later.
+//
+// Not modeled: the shift register (it only holds what was written), CA2/CB2
+// and the handshake modes, and input latching.
+
+typedef struct Via Via;
+
+enum
+{
+  VIA_PORT_A,
+  VIA_PORT_B,
+};
+
+enum
+{
+  VIA_CA1,
+  VIA_CB1,
+};
+
+// Creates a VIA on m with everything zero, like after RESET. Its interrupt
+// output drives the irq bit(s) of the IRQ line. Returns NULL when out of
+// memory.
+Via* via_create(Machine* m, unsigned irq);
+// Maps its 16 registers over start..end, repeated every 16 bytes.
+void via_map(Via* v, WORD start, WORD end);
+// Cancels its timers, lets go of the IRQ line and frees v. Pages mapped to v
+// have to be mapped to something else first.
+void via_destroy(Via* v);
+
+// Drives the input pins of port from the outside. Pins programmed as outputs
+// are not affected. With T2 counting pulses, PB6 going low counts one.
+void via_set_pins(Via* v, int port, BYTE pins);
+// The levels on the pins of port: ORA/ORB on outputs, PB7 from T1 when
+// enabled, what via_set_pins() set on inputs (all high at first).
+BYTE via_pins(const Via* v, int port);
+// Sets the level of CA1 or CB1. The edge chosen in PCR sets its interrupt flag.
+void via_set_control(Via* v, int line, int level);
+
+#endif